@@ -0,0 +1,130 @@
+#pragma once
+#include "huge_pages.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+ * Arena: a monotonic ("bump pointer") allocator.
+ *
+ * Think of a notepad: you write each new note below the last one and never
+ * erase individual lines. When the whole job is done you tear off every page
+ * at once (reset()) and start again from the top of the same pad.
+ *
+ * - allocate() is a pointer bump: no locks, no free lists, no malloc.
+ * - There is no per-object free; everything goes in one reset().
+ * - reset() keeps the pages, so once a batch has seen its biggest input the
+ *   arena never calls malloc again and its footprint stays fixed. That is
+ *   what makes peak RSS predictable: it's the sum of the arenas' high-water marks.
+ *
+ * One arena belongs to one owner at a time (a batch in the pipeline, or one
+ * worker thread); it is not thread-safe, and it doesn't need to be.
+ *
+ * set_node() gives the arena a home NUMA node: pages it gets from then on live
+ * in that node's memory, whichever thread writes them first (see numa_topology.h).
+ * lend() hands it a page it doesn't own, such as its slice of a slab of huge
+ * pages shared by several arenas (huge_pages.h); a page of 2 MiB or more it
+ * gets on its own is made of huge pages when they are on.
+ */
+class Arena {
+public:
+    explicit Arena(size_t block_size = 64 * 1024) : block_size_(block_size) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    Arena(Arena &&) = default;
+    Arena &operator=(Arena &&) = default;
+
+    void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        for (;;) {
+            if (current_ < blocks_.size()) {
+                Block &b = blocks_[current_];
+                size_t start = (offset_ + align - 1) & ~(align - 1);
+                if (start + bytes <= b.size) {
+                    offset_ = start + bytes;
+                    used_ += bytes;
+                    return b.data.get() + start;
+                }
+                // This page is full: move on to the next one we already own
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+            // Out of pages: the only place the arena ever touches malloc
+            size_t size = bytes + align > block_size_ ? bytes + align : block_size_;
+            blocks_.push_back(new_block(size));
+            reserved_ += blocks_.back().size;
+        }
+    }
+
+    template <typename T>
+    T *allocate_array(size_t count) {
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Copy a string into the arena; the view lives until the next reset()
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return {};
+        char *dst = static_cast<char *>(allocate(text.size(), 1));
+        std::memcpy(dst, text.data(), text.size());
+        return {dst, text.size()};
+    }
+
+    // Pages from now on come from this NUMA node (-1: wherever malloc puts them)
+    void set_node(int node) { node_ = node; }
+
+    // Use [data, data + size) as a page; the caller keeps it alive and frees it
+    void lend(char *data, size_t size) {
+        blocks_.push_back(Block{std::unique_ptr<char[], BlockFree>(data, BlockFree{0, true}), size});
+        reserved_ += size;
+    }
+
+    // Tear off every page at once; the pages themselves are kept for reuse
+    void reset() {
+        current_ = 0;
+        offset_ = 0;
+        used_ = 0;
+    }
+
+    size_t bytes_used() const { return used_; }         // Since the last reset()
+    size_t bytes_reserved() const { return reserved_; } // Total pages owned (the high-water mark)
+
+private:
+    // Frees a page the way it was allocated: delete[], unmapped if it came from
+    // map_pages(), or not at all if it was lent
+    struct BlockFree {
+        size_t mapped_bytes = 0;
+        bool lent = false;
+        void operator()(char *data) const {
+            if (lent) return;
+            if (mapped_bytes) unmap_pages(data, mapped_bytes);
+            else delete[] data;
+        }
+    };
+
+    struct Block {
+        std::unique_ptr<char[], BlockFree> data;
+        size_t size;
+    };
+
+    Block new_block(size_t size) {
+        const bool huge = huge_pages_enabled() && size >= kHugePageSize;
+        if (node_ >= 0 || huge) {
+            const size_t mapped = round_to_pages(size, huge ? kHugePageSize : kSmallPageSize);
+            if (char *data = static_cast<char *>(map_pages(mapped, node_)))
+                return Block{std::unique_ptr<char[], BlockFree>(data, BlockFree{mapped, false}), mapped};
+        }
+        return Block{std::unique_ptr<char[], BlockFree>(new char[size], BlockFree{0, false}), size};
+    }
+
+    size_t block_size_;
+    int node_ = -1;
+    std::vector<Block> blocks_;
+    size_t current_ = 0; // Page we're writing on
+    size_t offset_ = 0;  // Position on that page
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include "result_sink.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/*
+ * Apache Arrow IPC stream output (no Arrow library required).
+ *
+ * Arrow is the "shipping container" standard of analytics tools: pandas,
+ * polars, DuckDB, Spark... all know how to unload it without unpacking each
+ * box by hand. The stream format is a sequence of messages:
+ *
+ *   Schema           column names and types, sent once
+ *   DictionaryBatch  the issuer names (UNKNOWN, VISA, ...), sent once
+ *   RecordBatch      one per pipeline batch
+ *   end-of-stream    0xFFFFFFFF 0x00000000
+ *
+ * Each message is a small FlatBuffers header (encoded by hand in
+ * arrow_sink.cpp) followed by the raw column buffers. The columns are:
+ *
+ *   valid, low_confidence, luhn_pass, repetition_pass   bool (1 bit per row)
+ *   entropy                                             float32
+ *   issuer                                              dictionary<int8, utf8>
+ *
+ * The column buffers are filled in one pass over each batch's result array
+ * into scratch vectors that are reused for every batch, and the message
+ * headers are built in one reused FlatBuffers builder, so after the first
+ * batch no memory is allocated per row or per batch.
+ */
+class FlatBuilder; // arrow_sink.cpp
+
+class ArrowStreamWriter : public ResultSink {
+public:
+    explicit ArrowStreamWriter(std::ostream &out);
+    ~ArrowStreamWriter() override;
+
+    void write(const CardResult *results, size_t count) override;
+    bool finish() override;
+
+    uint64_t rows() const { return rows_; }
+
+private:
+    void write_preamble(); // Schema + issuer dictionary
+    void write_message(const std::vector<uint8_t> &metadata, const std::vector<uint8_t> &body);
+
+    std::ostream &out_;
+    bool started_ = false;
+    uint64_t rows_ = 0;
+
+    // Reused for every batch
+    std::vector<uint8_t> body_;
+    std::vector<uint8_t> metadata_;
+    std::unique_ptr<FlatBuilder> builder_;
+};
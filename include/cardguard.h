@@ -0,0 +1,115 @@
+#pragma once
+/*
+ * libcardguard: the validator as a library, behind a plain C ABI.
+ *
+ * Plain C so any language with a C FFI (C++, Go's cgo, Rust, Python's ctypes)
+ * can call it, and so the interface can't break when the C++ inside changes:
+ * only fixed-size POD structs and integers cross the boundary, never a
+ * std::string, a C++ exception or memory one side must free for the other.
+ *
+ * Batches are passed the way the shared-memory channel passes them: one
+ * buffer holding all the numbers back to back, and n + 1 offsets,
+ *
+ *     buf     = "4539148803436467378282246310005"
+ *     offsets = {0, 16, 31}                      -> card i is buf[offsets[i] .. offsets[i + 1])
+ *
+ * so a caller with numbers already packed in a column (Arrow, a CSV buffer,
+ * a Go []byte) hands them over without copying, and results land in an array
+ * the caller owns. Per card that costs what validate_card_quiet() costs.
+ *
+ *     cg_result out[2];
+ *     cg_validate_batch(buf, offsets, 2, out);
+ *     if (out[0].flags & CG_VALID) ...
+ *
+ * Every cg_validate* function is thread-safe. The cg_set_* configuration
+ * functions are not: call them before any thread starts validating.
+ *
+ * Build: make lib (build/lib/libcardguard.so and .a); link with -lcardguard.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define CG_API __attribute__((visibility("default")))
+#else
+#define CG_API
+#endif
+
+/* Bumped whenever a struct or signature below changes incompatibly */
+#define CG_ABI_VERSION 1
+
+/* Pass/fail bits of cg_result.flags */
+enum {
+    CG_VALID = 1 << 0,
+    CG_LOW_CONFIDENCE = 1 << 1,
+    CG_LENGTH_PASS = 1 << 2,
+    CG_CHECKSUM_PASS = 1 << 3, /* Luhn for cards, the type's own checksum otherwise */
+    CG_ENTROPY_PASS = 1 << 4,
+    CG_REPETITION_PASS = 1 << 5,
+};
+
+/* cg_result.issuer (card numbers only; other identifier types report CG_ISSUER_UNKNOWN) */
+enum {
+    CG_ISSUER_UNKNOWN = 0,
+    CG_ISSUER_VISA,
+    CG_ISSUER_MASTERCARD,
+    CG_ISSUER_AMEX,
+    CG_ISSUER_DISCOVER,
+    CG_ISSUER_DINERS,
+    CG_ISSUER_JCB,
+    CG_ISSUER_UNIONPAY,
+    CG_ISSUER_ENROUTE,
+};
+
+/* One answer: 8 bytes, no pointers */
+typedef struct cg_result {
+    uint8_t flags;
+    uint8_t issuer;
+    uint16_t reserved; /* 0 */
+    float entropy;     /* Shannon entropy of the digits, bits */
+} cg_result;
+
+/* CG_ABI_VERSION of the library actually loaded (compare with the header's) */
+CG_API uint32_t cg_abi_version(void);
+
+/* Validate card i = buf[offsets[i] .. offsets[i + 1]) for i < n into out[i].
+ * Returns how many are valid, or -1 if an argument is NULL (with n > 0) or
+ * the offsets go backwards. */
+CG_API long cg_validate_batch(const char *buf, const uint32_t *offsets, size_t n, cg_result *out);
+
+/* Same batch split over `threads` threads (0: one per hardware thread).
+ * Worth it from a few thousand cards up. */
+CG_API long cg_validate_batch_parallel(const char *buf, const uint32_t *offsets, size_t n, cg_result *out,
+                                       size_t threads);
+
+/* Fixed-width records, the layout of a NumPy "S<width>" array: card i is the
+ * `width` bytes at buf + i * stride, minus trailing NUL padding. Threads as
+ * for cg_validate_batch_parallel(). Returns how many are valid, or -1 if buf
+ * or out is NULL (with n > 0) or stride < width. */
+CG_API long cg_validate_fixed(const char *buf, size_t width, size_t stride, size_t n, cg_result *out,
+                              size_t threads);
+
+/* One number of `length` bytes; returns 1 if valid, 0 if not */
+CG_API int cg_validate(const char *number, size_t length, cg_result *out);
+
+/* Just the Luhn check (digits only); 1 = passes */
+CG_API int cg_luhn_check(const char *digits, size_t length);
+
+/* "VISA", "MASTERCARD", ... for a cg_result.issuer; "UNKNOWN" for anything else */
+CG_API const char *cg_issuer_name(uint8_t issuer);
+
+/* What the numbers are: "card" (default), "imei", "npi", "sin", "gtin" or "iban".
+ * Returns 0, or -1 for an unknown name. */
+CG_API int cg_set_type(const char *name);
+
+/* Replace the decision policy with rule text (the --policy file format).
+ * Returns 0, or -1 with a message in error[0 .. error_size) (error may be NULL). */
+CG_API int cg_set_policy(const char *text, char *error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+
+/*
+ * Checkpoints for long batch runs (--checkpoint FILE / --incremental FILE).
+ *
+ * Like a bookmark in a very long book: every few seconds the writer stage
+ * notes how far into the input it has got, how much of --output it has
+ * written and the running totals. If the run dies, the next run opens the
+ * book at the bookmark instead of page one. To make sure it is still the same
+ * book, the bookmark also keeps a CRC-32 of every input byte before it.
+ *
+ * The checkpoint only ever points at a batch boundary whose results are
+ * already written (and flushed), so a resumed run cuts --output back to the
+ * recorded length and appends: no record is lost or written twice.
+ *
+ * --incremental keeps the final bookmark after a successful run, so the next
+ * run of the same file only validates what was appended since. A last line
+ * without a newline is left for the next run (the exporter may still be
+ * writing it).
+ *
+ * The file is plain "key=value" text, replaced atomically (write + rename).
+ */
+
+struct CheckpointState {
+    std::string input;           // Input path
+    std::string format;          // "lines", "csv:<column>" or "jsonl:<key>"
+    std::string output;          // --output path ("" if none)
+    uint64_t offset = 0;         // Input bytes fully validated and written
+    uint32_t crc = 0;            // CRC-32 of input bytes [0, offset)
+    uint64_t line = 0;           // Input lines up to offset
+    uint64_t total = 0;          // Running totals up to offset
+    uint64_t valid = 0;
+    uint64_t low_confidence = 0;
+    uint64_t missing_field = 0;
+    uint64_t output_bytes = 0;   // Length of --output matching offset
+    bool complete = false;       // Written at the end of a successful run
+};
+
+// false if the file doesn't exist or isn't a checkpoint (no message for "doesn't exist")
+bool load_checkpoint(const std::string &path, CheckpointState &state);
+bool save_checkpoint(const std::string &path, const CheckpointState &state);
+
+// Read `bytes` bytes from `in` and return their CRC-32 (continuing from `crc`);
+// false if the stream ends first
+bool hash_prefix(std::istream &in, uint64_t bytes, uint32_t &crc);
+
+// Running CRC-32 of consecutive input chunks (zlib's crc32)
+uint32_t crc32_update(uint32_t crc, const char *data, size_t size);
+
+/*
+ * Checkpointer: owned by the caller, consulted by the pipeline's writer
+ * stage after every batch. due() is a clock check; save() writes the file,
+ * taking input/format/output from `identity` and the rest from `progress`.
+ */
+class Checkpointer {
+public:
+    Checkpointer(std::string path, CheckpointState identity, double interval_seconds)
+        : path_(std::move(path)), identity_(std::move(identity)),
+          interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(interval_seconds))),
+          last_save_(std::chrono::steady_clock::now()) {}
+
+    bool due() const { return std::chrono::steady_clock::now() - last_save_ >= interval_; }
+    bool save(const CheckpointState &progress);
+
+    const std::string &path() const { return path_; }
+    uint64_t saves() const { return saves_; }
+
+private:
+    std::string path_;
+    CheckpointState identity_;
+    std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point last_save_;
+    uint64_t saves_ = 0;
+};
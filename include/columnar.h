@@ -0,0 +1,141 @@
+#pragma once
+#include "result_sink.h"
+#include "validator.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+ * Columnar on-disk format for batch results (".cgcol").
+ *
+ * A text report is like a stack of index cards: to count the low-confidence
+ * cards you must pick up every single card. A columnar file is like a
+ * spreadsheet cut into vertical strips: to answer "how many are low
+ * confidence?" you only pull out that one strip, and because it's a strip of
+ * bits, counting it is a popcount over 64 rows at a time.
+ *
+ * File layout (all integers little-endian, every block 64-byte aligned):
+ *
+ *   ColumnarHeader                       fixed 64 bytes
+ *   row group 0: one block per column    valid bits | low-confidence bits |
+ *   row group 1: ...                     issuer ids | entropy (u8) | flags
+ *   ...
+ *   ColumnarGroupIndex[group_count]      where each group's blocks live
+ *
+ * Bit columns pack 64 rows per uint64_t word (row r is bit r % 64 of word r / 64).
+ * Entropy is rounded down to 1/32 bit (byte / 32.0 <= entropy < (byte + 1) / 32.0),
+ * which keeps the column one byte per row and still tells exactly which rows
+ * are below a threshold on that grid, such as 3.5 bits/digit. Version 1 files
+ * rounded to the nearest 1/32, so rows just under a threshold could land on it;
+ * the reader refuses them rather than count them wrong.
+ * Flags hold the CardResultFlag bits from validator.h.
+ *
+ * The magic is a fixed tag for "a CardGuard columnar file" and never changes
+ * (its "v1" is historical); the version field after it is what gets bumped.
+ */
+
+constexpr char kColumnarMagic[8] = {'C', 'G', 'C', 'O', 'L', 'v', '1', '\0'};
+constexpr uint32_t kColumnarVersion = 2;
+constexpr uint32_t kColumnarRowGroup = 64 * 1024; // Rows per group (a multiple of 64)
+
+enum class Column : uint8_t { Valid = 0, LowConfidence, Issuer, Entropy, Flags, Count };
+constexpr size_t kColumnCount = static_cast<size_t>(Column::Count);
+
+struct ColumnarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t row_group_size;
+    uint64_t row_count;
+    uint64_t group_count;
+    uint64_t index_offset; // File offset of the ColumnarGroupIndex array
+    uint8_t reserved[24];
+};
+static_assert(sizeof(ColumnarHeader) == 64, "header must stay one cache line");
+
+struct ColumnarGroupIndex {
+    uint64_t first_row;
+    uint64_t row_count;
+    uint64_t column_offset[kColumnCount]; // File offset of each column block
+    uint64_t valid_count;                 // Pre-counted, so totals don't even need the bitmap
+    uint64_t low_confidence_count;
+};
+
+inline uint8_t quantize_entropy(double entropy) {
+    double q = entropy * 32.0;
+    return q <= 0 ? 0 : q >= 255 ? 255 : static_cast<uint8_t>(q);
+}
+
+inline double dequantize_entropy(uint8_t q) {
+    return q / 32.0;
+}
+
+/*
+ * ColumnarWriter: buffers one row group column-by-column in memory and
+ * writes it out when full. finish() writes the index and the final header.
+ * It is also a ResultSink, so the batch pipeline can feed it directly.
+ */
+class ColumnarWriter : public ResultSink {
+public:
+    bool open(const std::string &path);
+    void append(const CardResult &res);
+    void write(const CardResult *results, size_t count) override;
+    bool finish() override; // Must be called; returns false if any write failed
+
+    uint64_t rows() const { return rows_; }
+
+private:
+    void flush_group();
+    uint64_t write_block(const void *data, size_t bytes);
+
+    std::ofstream file_;
+    std::string path_;
+    uint64_t rows_ = 0;
+    uint64_t offset_ = 0; // Current end of file
+
+    // The row group being filled
+    std::vector<uint64_t> valid_bits_, low_confidence_bits_;
+    std::vector<uint8_t> issuer_, entropy_, flags_;
+    uint32_t group_rows_ = 0;
+    std::vector<ColumnarGroupIndex> index_;
+};
+
+/*
+ * ColumnarReader: maps a .cgcol file read-only. Each scan touches only the
+ * pages of the column it reads; the others are never faulted in.
+ */
+class ColumnarReader {
+public:
+    ColumnarReader() = default;
+    ~ColumnarReader();
+    ColumnarReader(const ColumnarReader &) = delete;
+    ColumnarReader &operator=(const ColumnarReader &) = delete;
+
+    bool open(const std::string &path);
+
+    uint64_t rows() const { return header_ ? header_->row_count : 0; }
+    uint64_t group_count() const { return header_ ? header_->group_count : 0; }
+    const ColumnarGroupIndex &group(size_t g) const { return index_[g]; }
+
+    // Raw access to one column block of one row group
+    const uint64_t *bits(size_t g, Column column) const;
+    const uint8_t *bytes(size_t g, Column column) const;
+
+    // Popcount over a whole bit column (Valid or LowConfidence)
+    uint64_t count_set(Column column) const;
+    // Rows per issuer id, scanning only the issuer column
+    std::array<uint64_t, 256> issuer_histogram() const;
+    // Rows whose entropy is below `threshold` bits/digit (exact for multiples of 1/32)
+    uint64_t count_entropy_below(double threshold) const;
+
+private:
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    const ColumnarHeader *header_ = nullptr;
+    const ColumnarGroupIndex *index_ = nullptr;
+};
+
+// --columnar-scan FILE: print per-outcome and per-issuer counts
+int run_columnar_scan(const std::string &path);
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Transparent .gz / .zst input for batch mode, decompressed in memory.
+ *
+ * A compressed export is like a stack of vacuum-packed boxes. If the boxes
+ * were packed separately (a multi-frame .zst from pzstd or `zstd` run per
+ * chunk, or a BGZF .gz from bgzip), several people can unpack them at once
+ * and hand the contents over in the original order. If the whole file is one
+ * box (a plain gzip stream), one person unpacks it -- but on their own thread,
+ * so the validation pipeline keeps working while they do.
+ *
+ *   file (mmap) -> frame index -> decoder threads -> ordered window -> istream
+ *
+ * The decoders fill a fixed window of slots (two per thread); the pipeline's
+ * reader drains them in frame order through a plain std::istream, so it
+ * needs no changes. A decoder that gets too far ahead waits for a free slot,
+ * so memory stays bounded no matter how big the file is. Nothing is written
+ * to disk.
+ *
+ * The format is detected from the magic bytes, not the file name. gzip uses
+ * zlib; zstd needs a build with -DHAVE_ZSTD (and -lzstd).
+ */
+
+enum class Compression : uint8_t { None = 0, Gzip, Zstd };
+
+// Look at the first bytes of a file
+Compression detect_compression(const void *data, size_t size);
+const char *compression_name(Compression compression);
+
+class CompressedInput : public std::streambuf {
+public:
+    CompressedInput() = default;
+    ~CompressedInput() override;
+
+    CompressedInput(const CompressedInput &) = delete;
+    CompressedInput &operator=(const CompressedInput &) = delete;
+
+    // Map `path` and start `threads` decoders; false (after an [ERROR]) if it
+    // isn't a compressed file we can read
+    bool open(const std::string &path, size_t threads);
+
+    std::istream &stream() { return stream_; }
+
+    // Check after reading: a corrupt frame ends the stream early
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    const std::string &error() const { return error_; }
+
+    Compression compression() const { return compression_; }
+    size_t frames() const { return frames_.size(); }  // Independently decodable pieces found
+    size_t decoder_threads() const { return decoders_.size(); }
+    uint64_t decompressed_bytes() const { return decompressed_bytes_; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    struct Frame {
+        size_t offset;
+        size_t size;
+    };
+    struct Slot {
+        std::vector<char> data;
+        bool ready = false;
+    };
+
+    bool index_frames();
+    void parallel_decoder();  // Whole frames, several threads
+    void streaming_decoder(); // One frame (or a non-splittable stream), piece by piece
+    bool decode_frame(const Frame &frame, std::vector<char> &out, std::string &error) const;
+    Slot *claim_slot(uint64_t piece);     // Wait until `piece` may be written; nullptr = stop
+    void publish(uint64_t piece);
+    void fail(const std::string &error);
+
+    std::istream stream_{this};
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    Compression compression_ = Compression::None;
+    std::vector<Frame> frames_;
+
+    // The ordered window, guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable produced_, consumed_;
+    std::vector<Slot> window_;
+    uint64_t next_piece_ = 0;        // Next piece the reader will take
+    uint64_t next_claim_ = 0;        // Next frame a parallel decoder will take
+    uint64_t total_pieces_ = UINT64_MAX; // Known once the decoders are done
+    bool stop_ = false;
+    bool holding_ = false;           // The reader is draining window_[next_piece_]
+
+    std::vector<std::thread> decoders_;
+    std::atomic<bool> failed_{false};
+    std::string error_;
+    uint64_t decompressed_bytes_ = 0;
+};
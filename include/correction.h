@@ -0,0 +1,59 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+ * Check digits and typo suggestions for customer-facing forms.
+ *
+ * Luhn's sum is just the digits' "contributions" added up: a digit counts as
+ * itself, or (every second digit from the right) doubled with 9 taken off if
+ * it went past 9 -- kLuhnContribution in validator.h.
+ * So the effect of changing ONE digit is one subtraction and one addition;
+ * we never have to re-run luhn_check() on a candidate. It's like fixing a
+ * wrong total on a receipt: you don't re-add every line, you take the wrong
+ * line out and put the right one in.
+ *
+ * For a number that fails Luhn, that gives:
+ *   - single-digit typos: at every position exactly ONE replacement digit
+ *     brings the sum back to a multiple of 10 (both contribution tables are
+ *     permutations of 0-9), found with one reverse-table lookup;
+ *   - adjacent transpositions ("4532" typed as "4352"): swapping two
+ *     neighbours changes the sum by a known amount, checked in O(1).
+ * That is at most 19 + 18 candidates for a 19-digit number, each kept only if
+ * the issuer rules (IssuerRule in validator.h) accept its length and require
+ * a Luhn digit. A whole 16-digit suggestion list takes well under a microsecond.
+ */
+
+// The digit to append to `partial` (a number without its check digit) so it
+// passes Luhn; -1 if `partial` is empty, too long or not all digits.
+int luhn_check_digit(std::string_view partial);
+
+enum class EditKind : uint8_t { Substitution, Transposition };
+
+constexpr size_t kMaxPanDigits = 19;
+constexpr size_t kMaxCorrections = 2 * kMaxPanDigits - 1;
+
+// One suggested number. Owns its digits (no heap), so a caller can keep it.
+struct Correction {
+    char digits[kMaxPanDigits];
+    uint8_t length = 0;
+    uint8_t position = 0; // Changed digit (first of the swapped pair for a transposition)
+    EditKind kind = EditKind::Substitution;
+    Issuer issuer = Issuer::Unknown;
+    bool same_issuer = false; // The edit didn't change which scheme the prefix belongs to
+
+    std::string_view number() const { return {digits, length}; }
+};
+
+// Fill `out` (room for kMaxCorrections) with the Luhn-valid numbers one typo
+// or one adjacent swap away from `number`; returns how many. Transpositions
+// come first, then substitutions, each in position order, and suggestions that
+// keep the original issuer before those that don't. Returns 0 if `number`
+// already passes, isn't 1-19 digits, or its issuer uses no check digit.
+size_t suggest_corrections(std::string_view number, Correction *out);
+
+// --suggest NUMBER / --check-digit DIGITS: print the answers
+int run_suggest(std::string_view number);
+int run_check_digit(std::string_view partial);
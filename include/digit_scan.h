@@ -0,0 +1,149 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * The fused digit scan: every per-digit fact validate_card() needs, in one pass.
+ *
+ * The staged checks each walk the number on their own: normalize_input()
+ * looks for non-digits, detect_issuer_id() decodes the first four digits,
+ * luhn_check() decodes them all again, calculate_entropy() tallies them, and
+ * the repetition check compares stretches of the text pairwise. Five readers
+ * of the same sixteen bytes. Like a supermarket checkout that scans every item
+ * once and prints the total, the loyalty points and the receipt from that one
+ * scan, instead of running the basket past the till four times.
+ *
+ * scan_digits() loads the number once, right-aligned in two SSE2 registers
+ * padded with '0' (as mod10_sum() does), and from those registers works out:
+ *
+ *   digits     whether every character is 0-9    (one unsigned max and compare)
+ *   luhn_sum   the Luhn total                    (weighted lanes + SAD, as mod10_sum)
+ *   counts     how often each digit occurs       (ten compares + popcount)
+ *   prefix     the first four digits             (the issuer table index)
+ *   repeat     the shortest block that repeats back-to-back, e.g. 2 for "..1212.."
+ *              (per block length, one compare of the registers against themselves
+ *              shifted by that length, then a bit trick for a long enough run of equal digits)
+ *
+ * The entropy comes from the counts through a table of -p log2 p terms
+ * (scan_entropy(), validator.cpp), added up in the same order as
+ * calculate_entropy() does, so both give the same bits. Up to kMaxScanDigits
+ * characters; anything longer (never a valid card) takes the staged path.
+ */
+
+constexpr size_t kMaxScanDigits = 32;
+
+struct DigitScan {
+    bool digits = false;              // Every character is 0-9 (when not, nothing below is filled in)
+    size_t length = 0;
+    unsigned luhn_sum = 0;            // Valid Luhn when it ends in 0
+    unsigned prefix = 0;              // First four digits, a short number padded with 0s ("4" -> 4000)
+    unsigned repeat = 0;              // Shortest back-to-back repeated block (0: none)
+    std::array<uint8_t, 10> counts{}; // counts[d]: how many times digit d occurs
+};
+
+// Which of the staged checks or the fused scan validate_card() runs (--kernel)
+enum class DigitKernel : uint8_t { Fused, Staged };
+void set_digit_kernel(DigitKernel kernel); // Before starting any validation threads
+DigitKernel active_digit_kernel();
+
+// Shannon entropy in bits per digit, from a scan's counts
+double scan_entropy(const DigitScan &scan);
+
+inline DigitScan scan_digits_scalar(const char *p, size_t n) {
+    DigitScan scan;
+    scan.length = n;
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned d = unsigned(p[i] - '0');
+        if (d > 9) return scan;
+        const unsigned doubled = d * 2;
+        scan.luhn_sum += (n - 1 - i) & 1 ? (doubled > 9 ? doubled - 9 : doubled) : d;
+        scan.counts[d]++;
+        if (i < 4) scan.prefix = scan.prefix * 10 + d;
+    }
+    for (size_t i = n; i < 4; ++i) scan.prefix *= 10;
+    scan.digits = true;
+    for (size_t len = 1; len <= n / 2 && !scan.repeat; ++len)
+        for (size_t i = 0; i + 2 * len <= n; ++i)
+            if (std::memcmp(p + i, p + i + len, len) == 0) {
+                scan.repeat = unsigned(len);
+                break;
+            }
+    return scan;
+}
+
+inline DigitScan scan_digits(std::string_view number) {
+    const char *p = number.data();
+    const size_t n = number.size();
+#if defined(__SSE2__)
+    if (n <= kMaxScanDigits) {
+        DigitScan scan;
+        scan.length = n;
+
+        // Lanes 0-31 hold the number right-aligned behind '0's; 32-63 are only
+        // ever read as "the digit L places further on", past the number's end
+        alignas(16) char buf[64];
+        std::memset(buf, '0', 32);
+        std::memset(buf + 32, 0, 32);
+        std::memcpy(buf + 32 - n, p, n);
+        const __m128i zero_char = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+        const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i *>(buf));
+        const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i *>(buf + 16));
+        const __m128i d_lo = _mm_sub_epi8(lo, zero_char), d_hi = _mm_sub_epi8(hi, zero_char);
+
+        // Not a digit: below '0' wraps around to a big unsigned byte, so max(d, 9) != 9 catches both sides
+        const int in_range = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d_lo, nine), nine)) &
+                             _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d_hi, nine), nine));
+        if (in_range != 0xFFFF) return scan;
+        scan.digits = true;
+
+        // Luhn: lane 31 is the check digit, so the doubled digits are the even lanes
+        const __m128i doubled_lanes = _mm_set1_epi16(0x00FF);
+        __m128i total = _mm_setzero_si128();
+        const __m128i decoded[2] = {d_lo, d_hi};
+        for (const __m128i &d : decoded) {
+            __m128i w = _mm_add_epi8(d, d);
+            w = _mm_sub_epi8(w, _mm_and_si128(_mm_cmpgt_epi8(w, nine), nine));
+            const __m128i c = _mm_or_si128(_mm_and_si128(doubled_lanes, w), _mm_andnot_si128(doubled_lanes, d));
+            total = _mm_add_epi64(total, _mm_sad_epu8(c, _mm_setzero_si128()));
+        }
+        scan.luhn_sum = unsigned(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total)));
+
+        // Bit i of a 32-bit lane mask is lane i; the number is lanes 32-n to 31
+        const uint32_t number_lanes = n ? ~uint32_t(0) << (32 - n) : 0;
+        auto lane_mask = [](__m128i a, __m128i b) {
+            return uint32_t(_mm_movemask_epi8(a)) | uint32_t(_mm_movemask_epi8(b)) << 16;
+        };
+        for (unsigned d = 0; d < 10; ++d) {
+            const __m128i v = _mm_set1_epi8(char(d));
+            const uint32_t lanes = lane_mask(_mm_cmpeq_epi8(d_lo, v), _mm_cmpeq_epi8(d_hi, v)) & number_lanes;
+            scan.counts[d] = uint8_t(std::popcount(lanes));
+        }
+
+        for (size_t i = 0; i < 4; ++i) scan.prefix = scan.prefix * 10 + (i < n ? unsigned(p[i] - '0') : 0);
+
+        // Block length L: bit i of `same` says lane i equals lane i + L (both in
+        // the number). A repeat starts at i when lanes i .. i+L-1 all say so.
+        for (unsigned len = 1; len <= n / 2; ++len) {
+            const __m128i next_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + len));
+            const __m128i next_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 16 + len));
+            const uint32_t same = lane_mask(_mm_cmpeq_epi8(lo, next_lo), _mm_cmpeq_epi8(hi, next_hi)) &
+                                  number_lanes & (~uint32_t(0) >> len);
+            uint32_t run = same;
+            for (unsigned k = 1; k < len && run; ++k) run &= same >> k;
+            if (run) {
+                scan.repeat = len;
+                break;
+            }
+        }
+        return scan;
+    }
+#endif
+    return scan_digits_scalar(p, n);
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A small C++20 coroutine runtime over epoll, for the network modes.
+ *
+ * A thread per connection is like giving every restaurant guest a private
+ * waiter who stands by the table until they order: fine for ten tables,
+ * hopeless for ten thousand. Here one waiter (the event loop thread) walks
+ * the room, and each guest is a coroutine: a function that can stop in the
+ * middle ("co_await sock.readable()"), costs only its saved locals while it
+ * waits, and is picked up again exactly where it left off when epoll says its
+ * socket is ready. Nothing ever blocks the loop thread in a read or a write.
+ *
+ * The kitchen is a ComputePool: a coroutine with a big batch of work says
+ * "co_await pool.schedule()" and continues on a pool thread, then
+ * "co_await loop.schedule()" to come back to the loop thread for its I/O.
+ *
+ * Sockets are registered once, edge-triggered, for both directions. The
+ * rule that makes edge triggering safe: always try the read or write first,
+ * and only await readiness after it returned EAGAIN.
+ */
+
+// Fire-and-forget coroutine: starts running at once and frees its own frame
+// when it returns. Frames are counted, so servers can report their size.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void *operator new(size_t size);
+        static void operator delete(void *frame, size_t size);
+    };
+};
+
+// Live coroutine frames and the largest one ever allocated (bytes)
+size_t coroutine_frames_live();
+size_t coroutine_frame_bytes_max();
+
+class AsyncSocket;
+
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    bool ok() const { return epoll_ >= 0 && wake_ >= 0; }
+
+    // Dispatch readiness and posted coroutines until `stop` is raised
+    void run(const std::atomic<bool> &stop);
+
+    // Resume `handle` on the loop thread (callable from any thread)
+    void post(std::coroutine_handle<> handle);
+
+    // co_await loop.schedule(): continue on the loop thread
+    auto schedule() {
+        struct Awaiter {
+            EventLoop &loop;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // Destroy every coroutine still suspended on this loop (after run() has
+    // returned and any compute pool has drained), closing their sockets
+    void close_all();
+
+private:
+    friend class AsyncSocket;
+
+    int epoll_ = -1;
+    int wake_ = -1; // eventfd: post() from another thread interrupts epoll_wait()
+    std::mutex mutex_;
+    std::vector<std::coroutine_handle<>> posted_;
+    std::vector<std::coroutine_handle<>> running_;
+    AsyncSocket *sockets_ = nullptr; // Every registered socket, for close_all()
+};
+
+// A non-blocking socket registered with the loop. Lives in the coroutine's
+// frame; closes the descriptor when the coroutine ends.
+class AsyncSocket {
+public:
+    AsyncSocket(EventLoop &loop, int fd);
+    ~AsyncSocket();
+
+    AsyncSocket(const AsyncSocket &) = delete;
+    AsyncSocket &operator=(const AsyncSocket &) = delete;
+
+    bool ok() const { return registered_; }
+    int fd() const { return fd_; }
+
+    struct Awaiter {
+        std::coroutine_handle<> &slot;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) noexcept { slot = h; }
+        void await_resume() const noexcept {}
+    };
+    // Suspend until the socket may have become readable / writable (or failed)
+    Awaiter readable() { return Awaiter{reader_}; }
+    Awaiter writable() { return Awaiter{writer_}; }
+
+private:
+    friend class EventLoop;
+
+    EventLoop &loop_;
+    int fd_;
+    bool registered_ = false;
+    std::coroutine_handle<> reader_, writer_;
+    AsyncSocket *prev_ = nullptr, *next_ = nullptr;
+};
+
+class ComputePool {
+public:
+    explicit ComputePool(size_t threads);
+    ~ComputePool(); // Finishes queued work, then joins
+
+    ComputePool(const ComputePool &) = delete;
+    ComputePool &operator=(const ComputePool &) = delete;
+
+    // co_await pool.schedule(): continue on a pool thread
+    auto schedule() {
+        struct Awaiter {
+            ComputePool &pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { pool.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    void stop();
+    size_t size() const { return threads_.size(); }
+
+private:
+    void post(std::coroutine_handle<> handle);
+    void work();
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::coroutine_handle<>> queue_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Test PAN generator (--generate N): Luhn-valid numbers for load testing.
+ *
+ * Like a printing press with numbered plates: every output row has a fixed
+ * place in the file (row * (length + 1) bytes in), so each thread stamps its
+ * own stretch of rows without talking to the others. Where nothing is shared,
+ * nothing has to be waited for. A thread stamps 2 MiB of rows at a time into
+ * its own tray (one prefaulted page, a huge page with --huge-pages, see
+ * huge_pages.h) and pwrite()s it to the rows' place in the file: no page
+ * faults on the output, and the tray stays in cache from one stretch to the next.
+ *
+ * The "random" digits of row r come from a counter-based generator (wyrand's
+ * mixer applied to seed + r), so row r is always the same number for a given
+ * seed, no matter how many threads did the work or in which order.
+ *
+ * Each number is an issuer prefix from the same table detect_issuer_id()
+ * uses, random body digits, and a check digit. The Luhn sum is built up
+ * while the digits are produced (prefix contribution precomputed, then one
+ * table lookup per pair of body digits), so the check digit costs one modulo.
+ *
+ * Two knobs shape the digits, so the entropy and repetition stages downstream
+ * see realistic mixes:
+ *   entropy_digits   body digits come from only K distinct digits (entropy <= log2 K)
+ *   repeat_fraction  this share of numbers get a back-to-back repeated block ("4747")
+ * Uniform digits already repeat now and then: in 16 random digits two
+ * neighbours are equal more often than not.
+ */
+
+struct GeneratorOptions {
+    uint64_t count = 0;
+    std::vector<Issuer> issuers{Issuer::Visa, Issuer::Mastercard}; // Picked uniformly per number
+    size_t length = 16;
+    unsigned entropy_digits = 10; // 2..10
+    double repeat_fraction = 0.0; // 0..1
+    uint64_t seed = 1;
+    size_t threads = 1;
+};
+
+// Parse "VISA,AMEX" into issuers (false on an unknown name, or UNKNOWN itself)
+bool parse_issuer_list(const std::string &text, std::vector<Issuer> &issuers);
+
+// Write options.count numbers, one per line, to `path`; false after an [ERROR].
+// /dev/null (or any other non-regular file) works too, to time the generator alone.
+bool generate_pans(const GeneratorOptions &options, const std::string &path);
+
+// --generate N: check options, generate, print the [RESULT]/[TIME] lines
+int run_generate(const GeneratorOptions &options, const std::string &path);
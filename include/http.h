@@ -0,0 +1,120 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Embedded HTTP/1.1 endpoint for callers that would rather not link code.
+ *
+ *   POST /validate      body: ["4539148803436467", "378282246310005", ...]
+ *   200 OK              body: [{"result":"VALID","issuer":"VISA","entropy":3.20}, ...]
+ *
+ * Answers come back in the order the numbers were sent, with the same
+ * fields as the JSONL output (the numbers themselves are never echoed).
+ *
+ * Think of a bank counter. Keep-alive: a customer stays at the counter for
+ * several transactions instead of queueing again for each one (no new TCP
+ * handshake per request). Pipelining: the customer hands over several slips
+ * at once and the clerk answers them in order, so one network round trip
+ * can carry many requests.
+ *
+ * Nothing here allocates per request. The parser only hands out views into
+ * the connection's receive buffer, the JSON array is validated element by
+ * element straight from those bytes, and responses are written into buffers
+ * that are cleared, never freed. While a connection sits idle between
+ * requests it hands those buffers to a shared pool and takes some back when
+ * bytes arrive, so thousands of idle keep-alive clients hold no buffers at
+ * all, and once the pool has warmed up to the largest batches, serving runs
+ * with zero malloc calls.
+ *
+ * HttpConnection is only the protocol: bytes in, bytes out. Who reads the
+ * socket and when (the coroutine server in http_server.cpp) is a separate choice.
+ */
+
+constexpr size_t kHttpMaxHeaderBytes = 16 * 1024;       // Request line + headers
+constexpr size_t kHttpMaxBodyBytes = 8 * 1024 * 1024;   // Room for ~400k card numbers
+
+// One parsed request: views into the receive buffer, valid until it is consumed
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;
+    std::string_view body;
+    size_t header_bytes = 0;   // Request line, headers and the blank line
+    size_t content_length = 0;
+    bool keep_alive = true;    // HTTP/1.1 default; "Connection: close" or HTTP/1.0 turn it off
+    bool expect_continue = false;
+};
+
+enum class HttpParse : uint8_t { Incomplete, Complete, Error };
+
+// Parse the request at the start of `data`.
+//   Complete:   `req` is filled in; the request is req.header_bytes + req.content_length bytes long
+//   Incomplete: more bytes needed (req.header_bytes is already set once the headers are in)
+//   Error:      `status` is the HTTP status to answer with before closing
+HttpParse parse_http_request(std::string_view data, HttpRequest &req, int &status);
+
+// Validate a JSON array of card numbers (strings or bare digits), appending
+// one result object per element to `out`. Returns the element count, or -1
+// if `json` isn't such an array (`out` then holds a partial answer).
+long validate_json_array(std::string_view json, std::string &out);
+
+class HttpConnection {
+public:
+    // Where the next read() should put its bytes (grows as needed)
+    std::span<char> read_space();
+
+    // `n` bytes arrived in read_space(): answer every complete request in the
+    // buffer. False once the connection should close (after the output is sent).
+    bool on_data(size_t n) {
+        received(n);
+        return process();
+    }
+
+    // on_data() in two steps, so the caller can pick the thread that does
+    // the validation work in between
+    void received(size_t n) { in_used_ += n; }
+    bool process();
+
+    // Is the next buffered request complete, with a body of at least `bytes`?
+    bool large_request_ready(size_t bytes) const;
+
+    // Nothing buffered in either direction: give the buffers back to the pool
+    void release_idle_buffers();
+
+    // Response bytes waiting to be written, and how many of them were sent
+    std::string_view pending_output() const { return std::string_view(out_).substr(out_sent_); }
+    void consume_output(size_t n);
+
+    uint64_t requests() const { return requests_; }
+    uint64_t cards() const { return cards_; }
+
+private:
+    void answer(const HttpRequest &req);
+    void answer_error(int status);
+
+    std::vector<char> in_;
+    size_t in_used_ = 0;
+    std::string out_;  // Responses, possibly several (pipelining)
+    size_t out_sent_ = 0;
+    std::string body_; // Scratch for one response body, so its length is known before the headers
+    bool continue_sent_ = false;
+    bool closing_ = false;
+    uint64_t requests_ = 0;
+    uint64_t cards_ = 0;
+};
+
+// Split "[HOST:]PORT" (HOST defaults to 127.0.0.1); false if PORT is not 1-65535
+bool parse_listen_address(const std::string &text, std::string &host, uint16_t &port);
+
+// --http-serve [HOST:]PORT: one coroutine per connection on an epoll loop
+// (event_loop.h), bodies of kHttpOffloadBytes or more validated by
+// `threads` compute threads; until SIGINT/SIGTERM
+constexpr size_t kHttpOffloadBytes = 16 * 1024; // About 800 card numbers
+int run_http_server(const std::string &listen, size_t threads);
+
+// --http-bench [HOST:]PORT: requests/s and latency percentiles at batch sizes 1, 64 and 4096
+int run_http_benchmark(const std::string &target);
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ * Huge pages: fewer, bigger pages for the memory we sweep through.
+ *
+ * Every memory access needs its virtual address translated, and the CPU
+ * caches recent translations in the TLB, which only holds a few thousand
+ * entries. With 4 KiB pages that covers a few MiB; a binary search through an
+ * 8 MiB blocklist or a scan over a mapped multi-GB input misses it on nearly
+ * every step and pays a page-table walk. A 2 MiB page covers 512 times as much
+ * per entry. Like a street index that lists whole districts instead of single
+ * houses: the same book covers the whole city.
+ *
+ *   off        4 KiB pages everywhere (the default)
+ *   thp        transparent huge pages: 2 MiB-aligned mappings with
+ *              madvise(MADV_HUGEPAGE); the kernel backs them with huge pages
+ *              when it has some, and falls back silently when it has none
+ *   hugetlb    reserved huge pages (MAP_HUGETLB, see /proc/sys/vm/nr_hugepages):
+ *              guaranteed 2 MiB pages, falling back to thp when the pool is empty
+ *
+ * What uses them: the batch trays' first pages (one shared slab per worker
+ * group, pipeline.cpp), the policy's decision table and blocklist once they are
+ * over kLargeTableBytes, and the mapped input files (compressed input, segment
+ * logs, columnar files), where it is only a hint: file pages come as huge pages
+ * only on kernels built to do so for read-only files.
+ *
+ * The setting is process-wide, like the active policy: choose it once, at
+ * startup, before anything is allocated through it.
+ */
+
+enum class HugePages { Off, Transparent, Explicit }; // --huge-pages off|thp|hugetlb
+
+constexpr size_t kSmallPageSize = 4096;
+constexpr size_t kHugePageSize = 2u << 20;
+constexpr size_t kLargeTableBytes = kHugePageSize / 2; // Smaller tables stay on the heap
+
+struct MemoryOptions {
+    HugePages huge_pages = HugePages::Off;
+    bool lock = false; // --lock-memory: servers mlock() what they prefault
+};
+
+void set_memory_options(const MemoryOptions &options);
+const MemoryOptions &memory_options();
+inline bool huge_pages_enabled() { return memory_options().huge_pages != HugePages::Off; }
+
+inline size_t round_to_pages(size_t bytes, size_t page) { return (bytes + page - 1) / page * page; }
+
+// Page-aligned anonymous memory, zero-filled, placed on NUMA `node` (-1: anywhere).
+// A size that is a whole number of huge pages gets them while huge pages are
+// on; anything else is mapped with small pages. nullptr if the mapping fails.
+void *map_pages(size_t bytes, int node = -1);
+void unmap_pages(void *memory, size_t bytes);
+
+// Ask for huge pages on a read-only file mapping (a hint; see above)
+void advise_huge_mapping(void *memory, size_t bytes);
+
+// Fault every page of [memory, memory + bytes) in now, so the first request
+// that touches them doesn't; `write` also makes fresh anonymous pages real
+// (not the shared zero page). With `lock` they are mlock()ed too: false if
+// that was refused (RLIMIT_MEMLOCK, no CAP_IPC_LOCK), the pages are still in.
+bool prefault_pages(void *memory, size_t bytes, bool write, bool lock);
+
+// What the process holds in huge pages right now (/proc/self/smaps_rollup),
+// how many mappings asked for hugetlb pages but had to fall back, and the
+// page faults taken so far by all its threads
+size_t huge_page_bytes();
+uint64_t hugetlb_fallbacks();
+uint64_t page_faults();
+
+/*
+ * PageMapping: one map_pages() region, unmapped when it goes out of scope.
+ */
+class PageMapping {
+public:
+    PageMapping() = default;
+    PageMapping(size_t bytes, int node) : data_(static_cast<char *>(map_pages(bytes, node))), size_(data_ ? bytes : 0) {}
+    ~PageMapping() { unmap_pages(data_, size_); }
+
+    PageMapping(const PageMapping &) = delete;
+    PageMapping &operator=(const PageMapping &) = delete;
+    PageMapping(PageMapping &&other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    PageMapping &operator=(PageMapping &&other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    char *data() const { return data_; }
+    size_t size() const { return size_; }
+    explicit operator bool() const { return data_ != nullptr; }
+
+private:
+    char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/*
+ * LargePageAllocator: a std allocator for lookup tables. Below kLargeTableBytes
+ * it is plain operator new; from there on every allocation is its own mapping,
+ * rounded up to whole huge pages (untouched address space costs nothing), so it
+ * gets huge pages whenever they are on. Which path a block took depends only on
+ * its size, so freeing never needs to know what the setting was.
+ */
+void *allocate_table(size_t bytes);
+void free_table(void *memory, size_t bytes);
+
+template <typename T>
+struct LargePageAllocator {
+    using value_type = T;
+
+    LargePageAllocator() = default;
+    template <typename U>
+    LargePageAllocator(const LargePageAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(allocate_table(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { free_table(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const LargePageAllocator<U> &) const { return true; }
+};
+
+template <typename T>
+using LargePageVector = std::vector<T, LargePageAllocator<T>>;
@@ -0,0 +1,43 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+/*
+ * IBAN validation (ISO 13616, --type iban).
+ *
+ *   GB82 WEST 1234 5698 7654 32
+ *   ^^   country code: decides the total length (GB = 22 characters)
+ *     ^^ check digits: chosen so the whole thing is 1 modulo 97
+ *
+ * The official recipe: move the first four characters to the end, replace
+ * every letter by two digits (A = 10 ... Z = 35), read the result as one huge
+ * number and take it modulo 97. The "huge number" is 30-70 digits long, far
+ * past 64 bits, but we never need it whole: like doing long division on
+ * paper, we carry only the remainder. Characters are fed into a 64-bit
+ * accumulator (x10 plus the digit, or x100 plus the letter's value, both from
+ * one table so there is no branch), and every 8 characters -- at most 16
+ * digits, 97 * 10^16 still fits in 64 bits -- it is reduced modulo 97. No
+ * string is ever built, and nothing touches the heap.
+ *
+ * Country lengths live in a 26 x 26 table indexed by the two letters: one
+ * array read, no string compares. Spaces (the printed "GB82 WEST ..." form)
+ * are skipped, lowercase letters are accepted.
+ */
+
+// Characters an IBAN may have (any country)
+constexpr size_t kMaxIbanLength = 34;
+
+// Expected length for a country code ("DE" -> 22); 0 if the country has no IBAN
+size_t iban_country_length(char first, char second);
+
+// Remainder of the rearranged, letter-expanded IBAN modulo 97 (1 = valid).
+// `iban` must be compact (no spaces) and alphanumeric, at least 4 characters.
+unsigned iban_mod97(std::string_view iban);
+
+// The full check: country, length, characters, check digits. The result uses
+// the CardResult record like every other type: `length_pass` is the country
+// length check, `luhn_pass` the mod-97 check, and `issuer` the country code.
+CardResult validate_iban(std::string_view input, std::ostream *log);
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct RecordBatch;
+
+/*
+ * Structured input for batch mode: CSV and JSONL transaction exports.
+ *
+ * In a real export the card number is one field among many:
+ *
+ *   id,merchant,pan,amount              {"id":7,"pan":"4111...","amount":12.5}
+ *   7,"Joe's, Inc",4111...,12.50
+ *
+ * Reading it one character at a time is like proofreading a book letter by
+ * letter to find the commas. Instead the splitter looks at 64 bytes at once
+ * and turns them into bitmasks: "where are the quotes?", "where are the
+ * commas?", "where are the newlines?" (simdjson/simdcsv style). A running
+ * XOR over the quote bits tells which bytes are inside quotes, so a comma in
+ * "Joe's, Inc" is masked out without a branch per byte. Only the few bytes
+ * that matter (field and record boundaries) are then visited one by one.
+ *
+ * The PAN field is handed to the validator as a string_view into the batch
+ * arena (no copy). With pass-through on, the bytes before and after it are
+ * kept too, so the --output row is the original record with the PAN replaced
+ * by the result:
+ *
+ *   CSV    7,"Joe's, Inc",4111...,12.50   ->  2,7,"Joe's, Inc",VALID,VISA,3.28,12.50
+ *   JSONL  {"id":7,"pan":"4111..."}       ->  {"id":7,"line":2,"result":"VALID",...}
+ *
+ * The first CSV record is the header naming the columns. Records without the
+ * field are counted as missing and reported INVALID.
+ */
+
+enum class InputFormat : uint8_t { Lines = 0, Csv, Jsonl };
+
+struct InputSpec {
+    InputFormat format = InputFormat::Lines; // Lines: the whole line is the PAN
+    std::string field;                       // CSV column name or JSON key holding the PAN
+    bool passthrough = false;                // Keep the other fields in the --output rows
+};
+
+class RecordSplitter {
+public:
+    explicit RecordSplitter(const InputSpec &spec) : spec_(spec) {}
+
+    // Append every complete record in buf[0, len) to the batch and return the
+    // bytes used; the rest is an unfinished record to hand in again with the
+    // next chunk. With `last` set the tail is taken as a record too.
+    // line_number is the number of input lines consumed so far.
+    size_t split(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number);
+
+    bool failed() const { return !error_.empty(); }
+    const std::string &error() const { return error_; }
+    const std::string &header() const { return header_; } // CSV pass-through header row, "" if none
+    uint64_t missing() const { return missing_; }         // Records without the PAN field
+
+private:
+    size_t split_lines(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number);
+    size_t split_csv(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number);
+    size_t split_jsonl(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number);
+
+    InputSpec spec_;
+    bool header_done_ = false; // CSV: header read and column_ resolved
+    size_t column_ = 0;
+    size_t tail_fields_ = 0;   // CSV pass-through: header fields after the PAN column
+    std::string empty_fields_; // ... and commas standing in for a row's missing fields
+    std::string header_;
+    std::string error_;
+    uint64_t missing_ = 0;
+};
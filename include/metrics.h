@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/*
+ * Per-stage instrumentation for validate_card().
+ *
+ * Think of this like a relay race with a stopwatch at every hand-off:
+ * instead of one "[TIME]" for the whole race, each runner (stage) gets
+ * their own split time, and we keep a histogram of those splits so we can
+ * ask "how slow is the slowest 1%?" (the p99), not just "how slow on average?".
+ *
+ * - Every thread writes into its OWN counters (no sharing, no locks on the hot path).
+ * - Histograms are HDR-style: buckets grow logarithmically, with 4 sub-buckets
+ *   per power of two, so 40 cycles and 40 million cycles both land in a bucket
+ *   with ~25% resolution.
+ * - merge_metrics() walks every thread's counters only when somebody asks.
+ * - Card outcome counters are exact. Stage timings are SAMPLED (one card in
+ *   every `sample period`, 64 by default): reading the cycle counter twelve
+ *   times per card would cost more than some of the stages themselves, while
+ *   one card in 64 still gives a faithful p99 over any real batch.
+ *
+ * Build with -DCARDGUARD_NO_METRICS to compile every probe away entirely.
+ */
+
+enum class Stage : uint8_t {
+    Normalize = 0,
+    Length,
+    Issuer,
+    Luhn,
+    Entropy,
+    Repetition,
+    Policy,
+    Scan,  // The fused single pass (digit_scan.h) standing in for normalize..repetition
+    Count // Not a stage, just "how many stages there are"
+};
+
+const char *stage_name(Stage stage);
+
+// 64 powers of two x 4 sub-buckets covers every possible 64-bit cycle count
+constexpr size_t kSubBucketBits = 2;
+constexpr size_t kHistogramBuckets = 64 << kSubBucketBits;
+constexpr size_t kStageCount = static_cast<size_t>(Stage::Count);
+
+/*
+ * StageSnapshot: a plain (non-atomic) copy of one stage's numbers,
+ * produced by merging every thread's counters together.
+ */
+struct StageSnapshot {
+    uint64_t count = 0;
+    uint64_t sum_cycles = 0;
+    std::array<uint64_t, kHistogramBuckets> buckets{};
+
+    // Value (in cycles) below which `q` of the samples fall, e.g. q = 0.99 for p99
+    uint64_t percentile_cycles(double q) const;
+};
+
+struct MetricsSnapshot {
+    std::array<StageSnapshot, kStageCount> stages{};
+    uint64_t cards_total = 0;
+    uint64_t cards_valid = 0;
+    uint64_t cards_low_confidence = 0;
+    uint64_t cards_invalid = 0;
+    double cycles_per_second = 1.0; // TSC frequency, used to turn cycles into seconds
+    uint32_t sample_period = 1;     // Stage histograms hold one card in every `sample_period`
+};
+
+// Read the CPU's cycle counter (rdtsc). It costs a couple of dozen cycles,
+// far cheaper than asking the operating system for the time.
+inline uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Map a cycle count onto its log bucket: the position of the highest set bit
+// picks the power of two, the next two bits pick the sub-bucket.
+inline size_t histogram_bucket(uint64_t cycles) {
+    if (cycles < (1u << kSubBucketBits)) return static_cast<size_t>(cycles);
+    unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(cycles));
+    uint64_t sub = (cycles >> (msb - kSubBucketBits)) & ((1u << kSubBucketBits) - 1);
+    return (static_cast<size_t>(msb - kSubBucketBits + 1) << kSubBucketBits) + static_cast<size_t>(sub);
+}
+
+// Smallest cycle count that falls into the NEXT bucket (the bucket's upper bound)
+uint64_t histogram_bucket_limit(size_t bucket);
+
+// Runtime switch: probes are skipped (one predictable branch) until enabled
+void set_metrics_enabled(bool enabled);
+bool metrics_enabled();
+
+// Time one card in every `period` (1 = time every card). Call before the batch starts.
+void set_metrics_sample_period(uint32_t period);
+
+// Called once per card: true if this card's stages should be timed
+bool metrics_sample_card();
+
+// Hot-path recorders; they only touch the calling thread's counters
+void record_stage(Stage stage, uint64_t cycles);
+void record_card_outcome(bool valid, bool low_confidence);
+
+// Merge every thread's counters into one snapshot (cold path, takes a lock)
+MetricsSnapshot merge_metrics();
+
+// Write a snapshot in Prometheus text exposition format
+void write_prometheus(std::ostream &out, const MetricsSnapshot &snapshot);
+
+/*
+ * Dump the merged metrics to a target:
+ * - "unix:/path/to.sock"  -> connect to a Unix domain socket and write
+ * - "tcp:host:port"       -> connect over TCP and write
+ * - anything else         -> treated as a file path (overwritten)
+ * Returns false (and prints an [ERROR]) if the target could not be written.
+ */
+bool dump_metrics(const std::string &target);
+
+/*
+ * StageTimer: a stopwatch that starts when it's created and stops when it
+ * goes out of scope, so wrapping a stage is a single line:
+ *
+ *     { StageTimer t(Stage::Luhn, timed); res.luhn_pass = luhn_check(n); }
+ *
+ * `timed` comes from metrics_sample_card(), asked once at the start of the card.
+ */
+class StageTimer {
+public:
+#ifdef CARDGUARD_NO_METRICS
+    StageTimer(Stage, bool) {}
+#else
+    StageTimer(Stage stage, bool active)
+        : stage_(stage), active_(active), start_(active ? read_cycles() : 0) {}
+
+    ~StageTimer() {
+        if (active_) record_stage(stage_, read_cycles() - start_);
+    }
+#endif
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+#ifndef CARDGUARD_NO_METRICS
+private:
+    Stage stage_;
+    bool active_;
+    uint64_t start_;
+#endif
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * The mod-10 family: card numbers, IMEIs, NPIs, Canadian SINs, GTIN barcodes.
+ *
+ * They are all the same recipe with different seasoning. Walk the digits from
+ * the right; the check digit and every second digit after it count once, the
+ * others are multiplied by a weight (2 for Luhn, 3 for GTIN), and with Luhn a
+ * two-digit product counts as the sum of its digits (14 -> 1 + 4). The total
+ * must end in 0. Some identifiers also carry an invisible prefix: an NPI is
+ * checked as if it started with "80840", which always adds 24.
+ *
+ *   type   digits        weight  digit sum  implied prefix  first digit
+ *   card   issuer rules  2       yes        -               (issuer table)
+ *   imei   15            2       yes        -               any
+ *   npi    10            2       yes        80840 (+24)     1 or 2
+ *   sin    9             2       yes        -               not 0 or 8
+ *   gtin   8, 12, 13, 14 3       no         -               any
+ *
+ * mod10_sum<Weight, DigitSum>() is the one kernel behind all of them (and
+ * behind luhn_check()). With SSE2 it handles up to 32 digits without a loop:
+ * the digits are right-aligned in a buffer padded with '0', so "every second
+ * digit from the right" is always the same fixed set of byte lanes. One
+ * multiply weights those lanes, one compare-and-subtract folds two-digit
+ * products, and a SAD instruction adds all the bytes up.
+ */
+
+template <unsigned Weight, bool DigitSum>
+inline unsigned mod10_sum_scalar(const char *digits, size_t n) {
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned d = unsigned(digits[n - 1 - i] - '0');
+        if (i & 1) {
+            d *= Weight;
+            if (DigitSum && d > 9) d -= 9;
+        }
+        sum += d;
+    }
+    return sum;
+}
+
+template <unsigned Weight, bool DigitSum>
+inline unsigned mod10_sum(const char *digits, size_t n) {
+    static_assert(Weight >= 1 && Weight <= 9, "products must fit in a byte lane");
+    static_assert(!DigitSum || Weight == 2, "folding products by subtracting 9 only works for weight 2");
+#if defined(__SSE2__)
+    if (n <= 32) {
+        alignas(16) char buf[32];
+        std::memset(buf, '0', sizeof(buf));
+        std::memcpy(buf + sizeof(buf) - n, digits, n);
+
+        // Byte 31 is the check digit, so the weighted digits are the even-numbered bytes
+        const __m128i zero_char = _mm_set1_epi8('0');
+        const __m128i weighted_lanes = _mm_set1_epi16(0x00FF);
+        __m128i total = _mm_setzero_si128();
+        for (int half = 0; half < 2; ++half) {
+            __m128i d = _mm_sub_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(buf + 16 * half)), zero_char);
+            // Multiplying 16-bit lanes multiplies both bytes: products <= 81 never carry over
+            __m128i w = _mm_mullo_epi16(d, _mm_set1_epi16(Weight));
+            if (DigitSum) w = _mm_sub_epi8(w, _mm_and_si128(_mm_cmpgt_epi8(w, _mm_set1_epi8(9)), _mm_set1_epi8(9)));
+            __m128i c = _mm_or_si128(_mm_and_si128(weighted_lanes, w), _mm_andnot_si128(weighted_lanes, d));
+            total = _mm_add_epi64(total, _mm_sad_epu8(c, _mm_setzero_si128()));
+        }
+        return unsigned(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total)));
+    }
+#endif
+    return mod10_sum_scalar<Weight, DigitSum>(digits, n);
+}
+
+/* ---------------------
+   Identifier Types
+---------------------- */
+
+// Iban is the odd one out: a mod-97 check (iban.h) that shares the --type switch
+enum class IdType : uint8_t { Card = 0, Imei, Npi, Sin, Gtin, Iban, Count };
+IdType id_type_from_name(std::string_view name, bool &ok); // "imei" -> IdType::Imei
+const char *id_type_name(IdType type);                      // "IMEI" (what the issuer column shows)
+
+// Length, first-digit and checksum rules for one identifier (not cards: the
+// issuer table decides those)
+bool identifier_valid(IdType type, std::string_view digits, bool &length_pass, bool &checksum_pass);
+
+// The identifier type validate_card() / validate_card_quiet() check. Like the
+// policy, set it before any validation thread starts.
+IdType active_id_type();
+void set_active_id_type(IdType type);
+
+// validate_card*() for a non-card type: length, first digit and checksum only
+// (no entropy, repetition or policy: those are about card numbers). IBANs are
+// handed on to validate_iban().
+CardResult validate_identifier(std::string_view input, IdType type, std::ostream *log);
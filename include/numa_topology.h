@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * NUMA: which CPUs sit next to which memory, and how to keep the two together.
+ *
+ * On a two-socket machine each socket has its own memory (a NUMA node). A core
+ * can read the other socket's memory, but every cache miss then crosses the
+ * link between the sockets: slower, and shared with everyone else doing the
+ * same. Like two kitchens, each with its own pantry: a cook can walk to the
+ * other pantry, but it is far, and the corridor gets crowded.
+ *
+ * Read straight from sysfs and the kernel's own calls (sched_setaffinity,
+ * mbind), so no libnuma is needed. On a machine with one node everything here
+ * still works; it just has nothing to gain.
+ */
+
+enum class NumaMode { Off, Auto, On }; // --numa: Auto = On when there is more than one node
+
+struct NumaNode {
+    int id = 0;            // Kernel node number
+    std::vector<int> cpus; // CPUs of this node we are allowed to run on
+};
+
+// Nodes that have at least one CPU we may use, in node order. Without NUMA
+// information (no sysfs, no nodes) one pseudo-node 0 with every allowed CPU.
+std::vector<NumaNode> numa_nodes();
+
+// "0-3,8-11" <-> {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<int> parse_cpu_list(const std::string &text);
+std::string format_cpu_list(const std::vector<int> &cpus);
+
+// Let the calling thread run only on `node`'s CPUs (and so first-touch its memory there)
+bool pin_thread_to_node(const NumaNode &node);
+
+// Pages of the (page-aligned, not yet touched) mapping [memory, memory + bytes)
+// go to `node` when they are first touched, whoever touches them (mbind
+// MPOL_PREFERRED: another node only if this one is full). Best effort; a
+// negative node leaves it to first touch. map_pages() (huge_pages.h) calls this.
+void bind_to_node(void *memory, size_t bytes, int node);
@@ -0,0 +1,114 @@
+#pragma once
+#include "arena.h"
+#include "checkpoint.h"
+#include "ingest.h"
+#include "numa_topology.h"
+#include "result_sink.h"
+#include "validator.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Staged batch pipeline: reader -> validate workers -> formatter -> writer.
+ *
+ * Think of a restaurant kitchen: one person takes orders (reader), several
+ * cooks prepare them (validation workers), one person plates them in the
+ * right order (formatter), and one waiter carries them out (writer). If the
+ * waiter is slow, plates pile up at the pass -- but the cooks keep cooking
+ * until every tray is in use, and only then does the order-taker pause.
+ *
+ * Stages hand each other RecordBatch POINTERS through the lock-free rings in
+ * ring.h. A fixed pool of batches circulates (the writer returns finished
+ * batches to the reader), so memory stays bounded and the pool running dry is
+ * exactly the backpressure signal.
+ *
+ * Every variable-size byte a batch needs (the raw input chunk the records
+ * point into, the formatted output) comes from the batch's own Arena, which
+ * the reader resets when it recycles the tray. Once each tray has seen its
+ * biggest chunk, the steady state never calls malloc.
+ *
+ * On a NUMA machine (numa_topology.h) the kitchen is split by node: each node
+ * gets its own group of cooks, pinned to its CPUs, its own share of the trays,
+ * living in its memory, and its own copy of the policy tables. The reader
+ * deals batches out to the groups in turn; a group takes another node's batch
+ * only when it has run out of its own.
+ *
+ * With huge pages on (huge_pages.h) each group's trays start out on one shared
+ * slab of 2 MiB pages rather than a few hundred 4 KiB pages each.
+ */
+
+struct RecordBatch {
+    uint64_t sequence = 0;                   // Batch order in the input, so output stays in order
+    size_t home = 0;                         // Worker group (NUMA node) whose memory the batch lives in
+    size_t count = 0;                        // Records in use (vectors are reused, never shrunk)
+    Arena arena;                             // Input bytes + output text; reset on recycle
+    std::vector<std::string_view> records;   // The PAN of each record (views into the arena)
+    std::vector<uint64_t> line_numbers;      // 1-based input line of each record
+    std::vector<std::string_view> heads;     // CSV/JSONL pass-through: the record before the PAN field
+    std::vector<std::string_view> tails;     // ... and after it
+    std::vector<CardResult> results;         // Filled by the validation workers
+    std::string_view text;                   // Formatted output (in the arena), filled by the formatter
+    CheckpointState progress;                // Input position and running totals after this batch
+};
+
+struct PipelineOptions {
+    size_t workers = 0;               // Validation threads; 0 = one per hardware thread
+    size_t batch_size = 1024;         // Roughly this many records per batch (read as ~24 bytes each)
+    size_t batches_in_flight = 64;    // Pool size = the most batches that exist at once
+    std::ostream *output = nullptr;   // Per-card result lines; nullptr = summary only
+    std::vector<ResultSink *> sinks;  // Binary outputs fed by the writer stage (caller calls finish())
+    InputSpec input;                  // Plain lines, or which CSV column / JSON key holds the PAN
+    NumaMode numa = NumaMode::Auto;   // One worker group per NUMA node (Auto: if there are several)
+
+    // Checkpointing (checkpoint.h): `in` is already positioned at resume.offset
+    Checkpointer *checkpoint = nullptr; // Saved from the writer stage when due()
+    CheckpointState resume;           // Where a resumed run starts: offset, CRC, lines, totals
+    std::string csv_header;           // Resumed CSV run: the header record it no longer reads
+    bool hold_partial_tail = false;   // Leave a last line without a newline for the next run
+};
+
+/*
+ * RingStats: how full one conveyor belt was, sampled every time its
+ * consumer took a batch off. A belt that is always full points at a slow
+ * consumer; one that is always empty points at a slow producer.
+ */
+struct RingStats {
+    std::string name;
+    size_t capacity = 0;
+    uint64_t samples = 0;
+    uint64_t occupancy_sum = 0;
+    uint64_t occupancy_max = 0;
+    uint64_t producer_waits = 0; // Times the producer found no room / no free batch
+};
+
+// One worker group (NUMA node) of a run with NUMA placement
+struct NumaGroupStats {
+    int node = 0;
+    std::string cpus;            // "0-7,16-23"
+    size_t workers = 0;
+    uint64_t batches = 0;        // Validated by this group's workers...
+    uint64_t stolen = 0;         // ...of which were taken from another node
+};
+
+struct PipelineStats {
+    uint64_t total = 0;
+    uint64_t valid = 0;            // Includes the low-confidence ones
+    uint64_t low_confidence = 0;
+    uint64_t missing_field = 0;    // CSV/JSONL records without the PAN field (counted as invalid)
+    bool input_error = false;      // The input could not be read as requested (already reported)
+    size_t workers = 0;
+    size_t arena_bytes = 0;        // Memory held by all batch arenas at the end (their high-water mark)
+    CheckpointState progress;      // Where the run ended (offset, CRC, lines, totals, output bytes)
+    std::vector<RingStats> rings;
+    std::vector<NumaGroupStats> numa; // Empty when NUMA placement was off
+    size_t huge_page_bytes = 0;    // With huge pages on: the process's, as the run ended (trays still mapped)
+};
+
+// Run every line of `in` through the pipeline; blocks until the writer is done
+PipelineStats run_pipeline(std::istream &in, const PipelineOptions &options);
+
+// "[PIPELINE] ..." occupancy report, one line per ring
+void print_pipeline_stats(std::ostream &out, const PipelineStats &stats);
@@ -0,0 +1,143 @@
+#pragma once
+#include "huge_pages.h"
+#include "validator.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Decision policies: which cards are VALID, VALID (low confidence) or INVALID.
+ *
+ * The checks (Luhn, entropy, repetition...) are facts about a card; the
+ * policy is what a merchant decides to DO with those facts. It is written in
+ * a small text file, one rule per line, and the first rule that matches wins:
+ *
+ *   # The built-in policy
+ *   entropy_threshold 3.5                  what "entropy_pass" means in the results
+ *   rule not length 13..19 -> invalid
+ *   rule luhn fail -> invalid
+ *   rule entropy < 3.5 -> low_confidence
+ *   rule repetition fail -> low_confidence
+ *   default valid
+ *
+ * Conditions (joined with "and", each may start with "not"):
+ *
+ *   length 13..19 | length 15 | length 13,16,19     digit count
+ *   issuer VISA | issuer VISA,MASTERCARD           detected issuer
+ *   luhn pass|fail, repetition pass|fail           check outcomes
+ *   entropy < 3.2 (also <=, >, >=)                 bits per digit
+ *   blocked                                        number starts with a "block" prefix
+ *
+ *   block 400000 5555                               blocklisted prefixes (any number of lines)
+ *
+ * The policy comes second: a length the card's scheme doesn't allow (a
+ * 16-digit AMEX, see IssuerRule in validator.h) is INVALID whatever it says.
+ *
+ * Think of it like compiling a recipe into a lookup chart: at load time each
+ * rule becomes a row of bitmasks (which lengths, which issuers, which facts
+ * must be true or false). If the chart is small enough, every combination of
+ * (issuer, length, facts) is then worked out once, up front, into a flat
+ * byte table, so deciding a card is ONE array read: no strings, no virtual
+ * calls, no branches per rule.
+ *
+ * The table stays small (64 KiB at most); a blocklist can run to millions of
+ * prefixes, probed at random by every card's binary search. Past
+ * kLargeTableBytes it lives in huge pages when those are on (huge_pages.h), so
+ * a probe doesn't cost a TLB miss each.
+ */
+
+enum class Verdict : uint8_t { Invalid = 0, LowConfidence, Valid };
+
+// Fact bits a rule can test; entropy cut i ("entropy < cuts[i]") is bit kFactEntropyBelow + i
+enum PolicyFact : uint32_t {
+    kFactLuhn = 1u << 0,
+    kFactRepetition = 1u << 1,
+    kFactBlocked = 1u << 2,
+    kFactEntropyBelow = 3, // A bit NUMBER, not a mask
+};
+
+constexpr size_t kMaxPolicyLength = 31; // Lengths are one bit each in a uint32_t
+constexpr size_t kMaxEntropyCuts = 8;   // Distinct entropy thresholds a policy may use
+
+struct PolicyRule {
+    uint32_t lengths; // Bit L set: the rule applies to L-digit numbers
+    uint32_t issuers; // Bit i set: the rule applies to Issuer i
+    uint32_t care;    // Fact bits this rule tests...
+    uint32_t want;    // ...and the values they must have
+    Verdict verdict;
+};
+
+class Policy {
+public:
+    Policy(); // The built-in policy shown above
+
+    // Replace this policy with `text`; on failure *this is unchanged and
+    // `error` says which line was wrong
+    bool compile(std::string_view text, std::string &error);
+    bool load(const std::string &path); // compile() from a file; prints [ERROR] on failure
+
+    double entropy_threshold() const { return entropy_threshold_; }
+
+    // Can a number of this many digits be anything but INVALID? (checked before any digit work)
+    bool length_live(size_t length) const { return length <= kMaxPolicyLength && (live_lengths_ >> length & 1); }
+
+    uint32_t facts(bool luhn, bool repetition, double entropy, std::string_view digits) const {
+        uint32_t f = (luhn ? uint32_t(kFactLuhn) : 0u) | (repetition ? uint32_t(kFactRepetition) : 0u);
+        if (has_blocklist_ && blocked(digits)) f |= kFactBlocked;
+        for (size_t i = 0; i < cut_count_; ++i) f |= uint32_t(entropy < cuts_[i]) << (kFactEntropyBelow + i);
+        return f;
+    }
+
+    Verdict decide(size_t length, Issuer issuer, uint32_t facts) const {
+        if (!table_.empty())
+            return static_cast<Verdict>(table_[((size_t(issuer) * (kMaxPolicyLength + 1) + length) << fact_bits_) | facts]);
+        return scan(length, issuer, facts);
+    }
+
+    bool blocked(std::string_view digits) const;
+
+    size_t rule_count() const { return rules_.size(); }
+    size_t table_bytes() const { return table_.size(); }
+    size_t blocklist_size() const;
+
+    // Fault the tables in now, and mlock() them with `lock`, so a server's first
+    // requests don't wait for the pages. False if locking was refused.
+    bool prefault_tables(bool lock) const;
+    size_t tables_bytes() const { return table_.size() + blocklist_size() * sizeof(uint64_t); }
+    uint64_t fingerprint() const { return fingerprint_; } // Hash of the source text (checkpoints compare it)
+
+private:
+    struct EmptyTag {};
+    explicit Policy(EmptyTag) {} // No rules at all: what compile() builds on
+
+    Verdict scan(size_t length, Issuer issuer, uint32_t facts) const;
+    void build_table();
+
+    std::vector<PolicyRule> rules_;
+    Verdict default_ = Verdict::Valid;
+    double entropy_threshold_ = 3.5;
+    std::array<double, kMaxEntropyCuts> cuts_{};
+    size_t cut_count_ = 0;
+    size_t fact_bits_ = 0;
+    uint32_t live_lengths_ = 0;
+    std::vector<uint8_t> table_; // Verdict per (issuer, length, facts); empty = scan the rules
+
+    // Blocklisted prefixes, grouped by digit count and kept sorted for binary search
+    std::array<LargePageVector<uint64_t>, 20> blocklist_{};
+    bool has_blocklist_ = false;
+    uint64_t fingerprint_ = 0;
+};
+
+// The policy every validation uses. Set it before starting any validation
+// threads; it is read without locks.
+const Policy &active_policy();
+void set_active_policy(const Policy &policy);
+
+// From now on the calling thread reads `replica` instead: a copy of the active
+// policy in its own NUMA node's memory (see pipeline.cpp). nullptr goes back
+// to the shared one.
+void set_thread_policy(const Policy *replica);
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Hardware performance counter profiling (--profile mode).
+ *
+ * metrics.h tells us HOW LONG each stage takes. This tells us WHY:
+ * the CPU itself keeps tally sheets (cycles, instructions retired, branch
+ * mispredictions, cache misses) and Linux lets us read them through
+ * perf_event_open(). Like a mechanic's diagnostic plug, we attach it around
+ * one stage at a time and read the dials afterwards.
+ *
+ * The batch is grouped by PAN length and each stage runs as its own pass
+ * over a group, so every counter reading belongs to exactly one
+ * (stage, length) pair and the syscall cost is paid once per pass, not per card.
+ *
+ * If the kernel or the VM refuses to hand out a counter, that column simply
+ * reads "n/a" (cycles fall back to rdtsc), so the mode never fails outright.
+ */
+
+enum class PerfEvent : uint8_t {
+    Cycles = 0,
+    Instructions,
+    BranchMisses,
+    L1DMisses,
+    LLCMisses,
+    DTLBMisses,
+    Count
+};
+
+constexpr size_t kPerfEventCount = static_cast<size_t>(PerfEvent::Count);
+
+/*
+ * PerfCounterGroup: one perf_event_open group (leader = cycles) for the
+ * calling thread. Every member is started and stopped together, so the
+ * numbers describe exactly the same stretch of code.
+ */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup &) = delete;
+    PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+    bool available(PerfEvent event) const { return fds_[static_cast<size_t>(event)] >= 0; }
+    bool any_available() const;
+
+    void start();
+    // Stops counting and returns the counts since start(); unavailable events read 0
+    std::vector<uint64_t> stop();
+
+private:
+    int fds_[kPerfEventCount];
+    uint64_t ids_[kPerfEventCount];
+    uint64_t tsc_start_ = 0; // rdtsc fallback when the cycles counter is missing
+};
+
+/*
+ * InheritedCounter: one event counted for the calling thread AND every thread
+ * it starts from then on (perf's inherit flag), for a whole run of a
+ * multi-threaded mode. A finished thread's counts are added in when it exits,
+ * so read() after joining them all.
+ */
+class InheritedCounter {
+public:
+    explicit InheritedCounter(PerfEvent event);
+    ~InheritedCounter();
+
+    InheritedCounter(const InheritedCounter &) = delete;
+    InheritedCounter &operator=(const InheritedCounter &) = delete;
+
+    bool available() const { return fd_ >= 0; }
+    uint64_t read() const; // 0 when unavailable
+
+private:
+    int fd_ = -1;
+};
+
+// Validate every card stage-by-stage under the counters and print the report
+int run_profile(const std::vector<std::string> &cards, std::ostream &out);
@@ -0,0 +1,16 @@
+#pragma once
+#include "validator.h"
+#include <cstddef>
+
+/*
+ * ResultSink: anything the pipeline's writer stage can hand finished
+ * results to (a binary file format, a stream, ...). The writer calls
+ * write() once per batch, in input order, always from the same thread;
+ * the owner calls finish() after the pipeline returns.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+    virtual void write(const CardResult *results, size_t count) = 0;
+    virtual bool finish() = 0; // Flush and seal the output; false if anything failed
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/*
+ * Lock-free ring buffers used to connect the pipeline stages.
+ *
+ * Picture a conveyor belt with a fixed number of trays: the producer puts
+ * a tray on, the consumer takes one off, and nobody ever needs a lock because
+ * each side only moves its own marker. When the belt is full the producer has
+ * to wait -- that waiting IS the backpressure that stops a fast reader from
+ * burying a slow writer in memory.
+ *
+ * - SpscRing: exactly one producer thread and one consumer thread.
+ * - MpmcRing: any number of both (Dmitry Vyukov's bounded queue), used where
+ *   several validation workers share the same input or output belt.
+ *
+ * Both carry plain values (the pipeline passes batch POINTERS, so a "push"
+ * moves 8 bytes, never the records themselves). Capacity is rounded up to a
+ * power of two so "index % capacity" becomes a cheap bit mask. The head and
+ * tail markers live on separate 64-byte cache lines so the two sides don't
+ * keep stealing the same line from each other ("false sharing").
+ */
+
+constexpr size_t kCacheLine = 64;
+
+inline size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Polite waiting: spin briefly (cheap if the other side is about to act),
+// then hand the core back to the OS so we don't starve the thread we wait on.
+inline void ring_backoff(unsigned &spins) {
+    if (++spins < 64) return;
+    std::this_thread::yield();
+}
+
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(round_up_pow2(capacity < 2 ? 2 : capacity)), mask_(capacity_ - 1),
+          slots_(new T[capacity_]) {}
+
+    bool try_push(const T &value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == capacity_) {
+            // Looks full from our cached view; refresh it before giving up
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == capacity_) return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate fill level, good enough for occupancy metrics
+    size_t size() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    // Producer side: its own marker plus a cached copy of the consumer's
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+
+    // Consumer side, on its own cache line
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+};
+
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : capacity_(round_up_pow2(capacity < 2 ? 2 : capacity)), mask_(capacity_ - 1),
+          cells_(new Cell[capacity_]) {
+        // Every cell carries a ticket number saying whose turn it is
+        for (size_t i = 0; i < capacity_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(const T &value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                // The cell is free for ticket `pos`: try to claim it
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // The consumer hasn't emptied this cell yet: full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed); // Someone beat us to it
+            }
+        }
+    }
+
+    bool try_pop(T &out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = cell.value;
+                    // Hand the cell back to producers one full lap later
+                    cell.sequence.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Nothing published here yet: empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t size() const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct alignas(kCacheLine) Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Local stand-in for a Kafka topic: partitioned, append-only segment files.
+ *
+ *   LOG/partition-0/00000000000000000000.log    records 0 .. 999999
+ *   LOG/partition-0/00000000000001000000.log    records 1000000 ..
+ *   LOG/partition-1/...
+ *   LOG/<group>.offsets                         what consumer group <group> has committed
+ *
+ * Like a row of ledgers, one per partition, each filled page by page: a
+ * record is never changed once written, new ones only go at the end, and
+ * when a volume (segment) is full a new one is started, named after the
+ * first record number inside it. Each record is
+ *
+ *   offset  u64 little-endian   position in the partition: 0, 1, 2, ...
+ *   length  u32 little-endian   payload bytes
+ *   payload
+ *
+ * Readers map whole segments with mmap and hand out payloads as views into
+ * the mapping: a card number goes from the page cache to the validator
+ * without being copied.
+ *
+ * The consumer (--log-consume) writes one result record per input record to
+ * an output log with the same partitions, then commits, for each partition,
+ * "input consumed up to offset X, output written up to offset Y" in the
+ * offsets file. Commits happen once per several batches, not per record. A
+ * restarted consumer truncates each output partition back to its committed Y
+ * and reads on from X, so after a crash nothing is lost or duplicated.
+ */
+
+constexpr size_t kLogRecordHeader = 12;                  // offset + length
+constexpr uint64_t kDefaultSegmentBytes = 64ull << 20;   // Roll to a new segment past this size
+
+// One record as stored; `payload` points into a mapped segment
+struct LogRecord {
+    uint64_t offset;
+    std::string_view payload;
+};
+
+// "LOG/partition-N"
+std::string partition_dir(const std::string &log, uint32_t partition);
+
+// Partitions present under LOG (partition-0 .. partition-(N-1)); 0 if none
+uint32_t count_partitions(const std::string &log);
+
+/*
+ * Reads one partition front to back, a mapped segment at a time.
+ *
+ *     PartitionReader reader;
+ *     if (!reader.open(dir, first_offset)) ...
+ *     size_t n;
+ *     while ((n = reader.next(records, 4096)) > 0) ... records[0 .. n) ...
+ *
+ * Views stay valid until the next call to next() maps the following segment.
+ */
+class PartitionReader {
+public:
+    PartitionReader() = default;
+    ~PartitionReader();
+
+    PartitionReader(const PartitionReader &) = delete;
+    PartitionReader &operator=(const PartitionReader &) = delete;
+
+    bool open(const std::string &dir, uint64_t first_offset);
+
+    // Up to `max` records into `out`, never crossing a segment boundary; 0 at the end
+    size_t next(LogRecord *out, size_t max);
+
+    // Offset of the record next() would return first
+    uint64_t position() const { return next_offset_; }
+
+private:
+    bool map_segment(size_t index);
+    void unmap();
+
+    std::vector<std::string> segments_; // Paths, in offset order
+    size_t segment_ = 0;
+    const char *data_ = nullptr;
+    size_t size_ = 0, pos_ = 0;
+    uint64_t next_offset_ = 0;
+};
+
+/*
+ * Appends to one partition. open() finds the end of the last segment (and
+ * cuts off a half-written record a crash may have left there), or with
+ * truncate_to cuts the partition back to that many records first.
+ */
+class PartitionWriter {
+public:
+    PartitionWriter() = default;
+    ~PartitionWriter();
+
+    PartitionWriter(const PartitionWriter &) = delete;
+    PartitionWriter &operator=(const PartitionWriter &) = delete;
+
+    static constexpr uint64_t kNoTruncate = ~uint64_t(0);
+    bool open(const std::string &dir, uint64_t truncate_to = kNoTruncate,
+              uint64_t segment_bytes = kDefaultSegmentBytes);
+
+    // Buffer one record; it reaches the file at the next flush(). False if a
+    // flush or a new segment along the way failed (the record is not taken).
+    bool append(std::string_view payload);
+    // False if the write failed: what did reach the file is dropped from the
+    // buffer, the rest is kept for the next try
+    bool flush();
+
+    uint64_t next_offset() const { return next_offset_; }
+
+private:
+    bool start_segment();
+
+    std::string dir_;
+    int fd_ = -1;
+    uint64_t segment_size_ = 0, segment_bytes_ = kDefaultSegmentBytes;
+    uint64_t next_offset_ = 0;
+    std::vector<char> pending_;
+};
+
+// Committed position of one partition for a consumer group
+struct CommittedOffset {
+    uint64_t input = 0;  // Next input record to consume
+    uint64_t output = 0; // Output records written for everything before it
+};
+
+// "<group>.offsets" in LOG: one "partition input output" line each, replaced
+// atomically (write + rename). A missing file means nothing is committed yet.
+bool load_offsets(const std::string &path, std::vector<CommittedOffset> &offsets);
+bool save_offsets(const std::string &path, const std::vector<CommittedOffset> &offsets);
+
+// --log-append FILE --log LOG: append each line of FILE as one record,
+// spread round-robin over `partitions` partitions (the test producer)
+int run_log_append(const std::string &input, const std::string &log, uint32_t partitions, uint64_t segment_bytes);
+
+// --log-consume LOG --log-out OUT: validate every uncommitted record of
+// every partition (one thread per partition, up to `threads`), produce
+// results to OUT, commit as consumer group `group`
+int run_log_consume(const std::string &log, const std::string &out, const std::string &group, size_t threads);
@@ -0,0 +1,154 @@
+#pragma once
+#include "validator.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Shared-memory channel between a co-located client and the validator.
+ *
+ * Think of two neighbours sharing a mailbox bolted to the fence between
+ * their gardens: the client drops a batch of card numbers into a numbered
+ * pigeonhole, the validator picks it up, writes the answers into the
+ * matching pigeonhole on the other side, and raises a flag. Nobody walks to
+ * the post office (the kernel) as long as both are watching the box.
+ *
+ * Layout of the mapping (everything is plain data, no pointers, so both
+ * processes can use it even though it's mapped at different addresses):
+ *
+ *   ShmChannel header | ShmRequestSlot[kShmSlots] | ShmResponseSlot[kShmSlots]
+ *
+ * Request slot i is answered in response slot i. Sequence numbers only ever
+ * grow; "sequence % kShmSlots" picks the slot. The client may have at most
+ * kShmSlots batches outstanding.
+ *
+ * Waiting: each side spins for a short while (the steady-state path: zero
+ * syscalls), and only if nothing arrives does it announce "I'm asleep" and
+ * block on a futex. The other side only pays for a FUTEX_WAKE syscall when
+ * that announcement is up.
+ */
+
+constexpr uint32_t kShmMagic = 0x43475348; // "CGSH"
+constexpr uint32_t kShmVersion = 2;
+constexpr uint32_t kShmSlots = 16;             // Power of two
+constexpr uint32_t kShmMaxBatch = 256;         // Cards per request slot
+constexpr uint32_t kShmMaxBytes = kShmMaxBatch * 32;
+
+// A CardResult squeezed into 8 POD bytes (no std::string across processes)
+struct ShmResult {
+    uint8_t flags;    // CardResultFlag bits
+    uint8_t issuer;   // static_cast<uint8_t>(Issuer)
+    uint16_t reserved;
+    float entropy;
+};
+
+// Card i occupies bytes[offsets[i] .. offsets[i + 1])
+struct ShmRequestSlot {
+    uint32_t count;
+    uint32_t offsets[kShmMaxBatch + 1];
+    char bytes[kShmMaxBytes];
+};
+
+struct ShmResponseSlot {
+    uint32_t count;
+    ShmResult results[kShmMaxBatch];
+};
+
+struct ShmChannel {
+    std::atomic<uint32_t> magic; // Written last by the server: "the channel is ready"
+    uint32_t version;
+    uint32_t slots;
+    uint32_t max_batch;
+
+    // Client -> server direction. request_tail is also the server's futex word.
+    alignas(64) std::atomic<uint32_t> request_tail;
+    std::atomic<uint32_t> server_sleeping;
+    alignas(64) std::atomic<uint32_t> request_head;
+
+    // Server -> client direction. response_tail is also the client's futex word.
+    alignas(64) std::atomic<uint32_t> response_tail;
+    std::atomic<uint32_t> client_sleeping;
+    alignas(64) std::atomic<uint32_t> response_head;
+
+    alignas(64) std::atomic<uint32_t> shutdown;
+    std::atomic<uint32_t> client_pid; // 0 while no client is attached
+};
+
+constexpr size_t kShmRequestOffset = (sizeof(ShmChannel) + 63) & ~size_t(63);
+constexpr size_t kShmResponseOffset =
+    kShmRequestOffset + ((sizeof(ShmRequestSlot) * kShmSlots + 63) & ~size_t(63));
+constexpr size_t kShmMappingSize = kShmResponseOffset + sizeof(ShmResponseSlot) * kShmSlots;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex words must be plain 32-bit integers");
+
+inline ShmRequestSlot *shm_request_slots(ShmChannel *channel) {
+    return reinterpret_cast<ShmRequestSlot *>(reinterpret_cast<char *>(channel) + kShmRequestOffset);
+}
+
+inline ShmResponseSlot *shm_response_slots(ShmChannel *channel) {
+    return reinterpret_cast<ShmResponseSlot *>(reinterpret_cast<char *>(channel) + kShmResponseOffset);
+}
+
+// Sleep while *word still equals `expected` (or until the timeout passes).
+// Not FUTEX_PRIVATE: the word lives in memory shared between processes.
+inline void shm_futex_wait(std::atomic<uint32_t> &word, uint32_t expected, long timeout_ns) {
+    timespec ts{static_cast<time_t>(timeout_ns / 1000000000L), timeout_ns % 1000000000L};
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+inline void shm_futex_wake(std::atomic<uint32_t> &word) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+/*
+ * Wait until `word` moves past `seen`: spin first, then sleep on the futex
+ * with the `sleeping` flag raised so the other side knows to wake us.
+ * Returns the new value (or `seen` if `stop` was raised meanwhile).
+ */
+inline uint32_t shm_wait_for_change(std::atomic<uint32_t> &word, uint32_t seen,
+                                    std::atomic<uint32_t> &sleeping, const std::atomic<uint32_t> &stop) {
+    // Spinning only pays off if the other side is running on another core
+    static const int spin_limit = ::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 20000 : 0;
+    for (int spin = 0; spin < spin_limit; ++spin) {
+        uint32_t now = word.load(std::memory_order_acquire);
+        if (now != seen) return now;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    for (;;) {
+        sleeping.store(1, std::memory_order_seq_cst);
+        uint32_t now = word.load(std::memory_order_seq_cst);
+        if (now != seen || stop.load(std::memory_order_relaxed)) {
+            sleeping.store(0, std::memory_order_relaxed);
+            return now;
+        }
+        shm_futex_wait(word, seen, 100000000L); // 100 ms, so a shutdown is noticed
+        sleeping.store(0, std::memory_order_relaxed);
+        now = word.load(std::memory_order_acquire);
+        if (now != seen || stop.load(std::memory_order_relaxed)) return now;
+    }
+}
+
+// Publish a new value for `word` and wake the other side only if it is asleep
+inline void shm_publish(std::atomic<uint32_t> &word, uint32_t value, std::atomic<uint32_t> &sleeping) {
+    word.store(value, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst)) shm_futex_wake(word);
+}
+
+// Fill one POD result from a full CardResult
+inline ShmResult to_shm_result(const CardResult &res) {
+    ShmResult out{};
+    out.flags = result_flags(res);
+    out.issuer = static_cast<uint8_t>(res.issuer_id);
+    out.entropy = static_cast<float>(res.entropy);
+    return out;
+}
+
+// Server side: create the named channel and serve requests until SIGINT/SIGTERM
+int run_shm_server(const std::string &name);
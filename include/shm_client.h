@@ -0,0 +1,54 @@
+#pragma once
+#include "shm_channel.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * ShmClient: the co-located side of the shared-memory channel.
+ *
+ * Two ways to use it:
+ *
+ * 1. Convenience: validate(cards, results) copies the card numbers into the
+ *    next request slot, waits, and copies the answers out.
+ *
+ * 2. Zero-copy: write straight into the shared slot yourself.
+ *
+ *        ShmRequestSlot *slot = client.begin_request();   // nullptr if all slots are busy
+ *        ... fill slot->count, slot->offsets, slot->bytes ...
+ *        uint32_t ticket = client.submit();
+ *        const ShmResponseSlot *answer = client.wait(ticket);
+ *        ... read answer->results[0 .. answer->count) ...
+ *        client.release(ticket);
+ *
+ * One client per channel at a time; open() refuses a channel that is in use,
+ * unless the process holding it has died, in which case it takes over.
+ */
+class ShmClient {
+public:
+    ShmClient() = default;
+    ~ShmClient();
+
+    ShmClient(const ShmClient &) = delete;
+    ShmClient &operator=(const ShmClient &) = delete;
+
+    // Attach to the channel a server created with run_shm_server(name)
+    bool open(const std::string &name);
+    void close();
+    bool is_open() const { return channel_ != nullptr; }
+
+    ShmRequestSlot *begin_request();
+    uint32_t submit();
+    const ShmResponseSlot *wait(uint32_t ticket);
+    void release(uint32_t ticket);
+
+    // Copying convenience wrapper; at most kShmMaxBatch cards (and kShmMaxBytes bytes) per call
+    bool validate(const std::vector<std::string_view> &cards, std::vector<ShmResult> &results);
+
+private:
+    ShmChannel *channel_ = nullptr;
+    uint32_t next_ticket_ = 0; // Sequence number of the next request we will submit
+};
+
+// Round-trip latency benchmark against a running server (--shm-bench NAME)
+int run_shm_benchmark(const std::string &name);
@@ -1,21 +1,122 @@
 #pragma once
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
+
+// CARDGUARD_HOT_CLONES marks a hot function to be compiled twice, for AVX2 and
+// for any x86-64, with the loader picking the one this CPU can run (GCC's
+// function multiversioning). Whatever gets inlined into it is cloned along, so
+// it goes on the per-card entry points, not on every little helper. The
+// Makefile's optimized builds define CARDGUARD_MULTIVERSION to turn it on.
+#if defined(CARDGUARD_MULTIVERSION) && defined(__x86_64__) && defined(__GNUC__)
+#define CARDGUARD_HOT_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define CARDGUARD_HOT_CLONES
+#endif
+
+// Issuer as a small number, for binary outputs and IPC where a string won't do.
+// The names match what detect_issuer() returns. New schemes go at the end, so
+// ids already written to columnar files keep their meaning.
+enum class Issuer : uint8_t { Unknown = 0, Visa, Mastercard, Amex, Discover, Diners, Jcb, UnionPay, Enroute, Count };
+Issuer issuer_from_name(std::string_view name);
+const char *issuer_name(Issuer issuer);
+
+/*
+ * IssuerRule: what a card scheme allows, packed into one 32-bit word.
+ * Bit L set means "L digits is a valid length for this scheme"; bit 0 (no
+ * card has 0 digits) means "the last digit is a Luhn check digit".
+ *
+ *   AMEX      0x00008001   bit 15 + bit 0: only 15 digits, Luhn required
+ *   UNIONPAY  0x000F0000   bits 16-19: 16 to 19 digits, no Luhn
+ *
+ * Like the height bar at a fairground ride: one glance at the card's prefix
+ * and length and it is either waved through or turned away before anyone
+ * looks at the rest of the digits.
+ */
+struct IssuerRule {
+    uint32_t bits;
+
+    // Bit 0 is the Luhn flag, not a length: no scheme allows an empty number
+    constexpr bool allows(size_t length) const { return length >= 1 && length < 32 && (bits >> length & 1); }
+    constexpr bool luhn_required() const { return bits & 1; }
+};
+IssuerRule issuer_rule(Issuer issuer);
+
+// The 4-digit prefix (IIN) ranges each scheme owns; detect_issuer_id() is built from these
+struct IssuerPrefixRange {
+    uint16_t first, last;
+    Issuer issuer;
+};
+std::span<const IssuerPrefixRange> issuer_prefix_ranges();
+
+// What a digit adds to the Luhn sum, by position: kLuhnContribution[doubled][digit].
+// Row 1 is Luhn's "double it, and subtract 9 if it got too big" as a lookup.
+inline constexpr uint8_t kLuhnContribution[2][10] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9},
+    {0, 2, 4, 6, 8, 1, 3, 5, 7, 9},
+};
 
 /*
  * CardResult: Holds the results of validation for a single card number
  * - valid: true if passes Luhn (or low-confidence)
- * - luhn_pass: whether Luhn checksum passed
+ * - low_confidence: passed Luhn, but failed entropy or repetition
+ * - length_pass: a length the issuer allows (13 to 19 digits if the issuer is unknown)
+ * - luhn_pass: whether Luhn checksum passed (always true for schemes without a check digit)
  * - entropy: bits per digit
+ * - entropy_pass: entropy reached the 3.5 bits/digit threshold
  * - repetition_pass: check for repeated sequences
- * - issuer: VISA / MASTERCARD / UNKNOWN
+ * - issuer: VISA / MASTERCARD / AMEX / ... / UNKNOWN (a view of a static name, never freed)
+ * - issuer_id: the same issuer as a small number (see Issuer below)
+ *
+ * Every field has a default so a card that stops early (e.g. wrong length)
+ * still reports sensible "failed" values instead of garbage. Nothing in it
+ * owns heap memory, so filling millions of them never calls malloc.
  */
 struct CardResult {
-    bool valid;
-    bool luhn_pass;
-    double entropy;
-    bool repetition_pass;
-    std::string issuer;
+    bool valid = false;
+    bool low_confidence = false;
+    bool length_pass = false;
+    bool luhn_pass = false;
+    double entropy = 0.0;
+    bool entropy_pass = false;
+    bool repetition_pass = false;
+    std::string_view issuer = "UNKNOWN";
+    Issuer issuer_id = Issuer::Unknown;
+};
+
+// A CardResult's pass/fail answers packed into one byte, for binary outputs and IPC
+enum CardResultFlag : uint8_t {
+    kFlagValid = 1 << 0,
+    kFlagLowConfidence = 1 << 1,
+    kFlagLengthPass = 1 << 2,
+    kFlagLuhnPass = 1 << 3,
+    kFlagEntropyPass = 1 << 4,
+    kFlagRepetitionPass = 1 << 5,
 };
 
+inline uint8_t result_flags(const CardResult &res) {
+    return static_cast<uint8_t>((res.valid ? kFlagValid : 0) | (res.low_confidence ? kFlagLowConfidence : 0) |
+                                (res.length_pass ? kFlagLengthPass : 0) | (res.luhn_pass ? kFlagLuhnPass : 0) |
+                                (res.entropy_pass ? kFlagEntropyPass : 0) |
+                                (res.repetition_pass ? kFlagRepetitionPass : 0));
+}
+
+// The verdict as text output shows it: "VALID", "VALID_LOW_CONFIDENCE" or "INVALID"
+inline const char *result_label(const CardResult &res) {
+    if (!res.valid) return "INVALID";
+    return res.low_confidence ? "VALID_LOW_CONFIDENCE" : "VALID";
+}
+
+// Helper declarations (the individual validation stages)
+std::string_view normalize_input(std::string_view input);
+std::string_view detect_issuer(std::string_view number);
+Issuer detect_issuer_id(std::string_view number);
+Issuer issuer_from_prefix(unsigned prefix); // From the first four digits as a number, 0-9999
+bool luhn_check(std::string_view number);
+double calculate_entropy(std::string_view number);
+bool repetition_check_optimized(std::string_view number);
+
 // Function declarations
-CardResult validate_card(const std::string &input);
+CardResult validate_card(const std::string &input);       // Prints [INFO]/[RESULT]/[TIME] lines
+CardResult validate_card_quiet(std::string_view input);   // Same checks, no printing (batch mode)
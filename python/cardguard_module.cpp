@@ -0,0 +1,311 @@
+/*
+ * Python binding: `import cardguard`, the library's batch calls for NumPy
+ * and Arrow columns.
+ *
+ * Numbers come in through the buffer protocol, so the validator reads them
+ * right where NumPy or Arrow keeps them: no copy, and no Python object per
+ * card. While it works the GIL is released (other Python threads carry on)
+ * and the batch is split over threads. Answers go out as plain NumPy arrays.
+ *
+ *     import numpy as np, cardguard
+ *     pans = np.array([b"4539148803436467", b"378282246310005"])     # dtype S16
+ *     r = cardguard.validate(pans)
+ *     r["valid"]    -> array([ True,  True])       bool
+ *     r["issuer"]   -> array([1, 3], dtype=uint8)  index into cardguard.ISSUERS
+ *     r["entropy"]  -> array([2.95, 3.01], dtype=float32)
+ *     r["flags"]    -> array([15, 15], dtype=uint8) cardguard.VALID | ...
+ *
+ * Arrow string columns pass their data and offsets buffers, and where the
+ * array starts in them (a slice shares its parent's buffers):
+ *
+ *     col = pa.chunked_array(...).combine_chunks()
+ *     _, offsets, data = col.buffers()
+ *     r = cardguard.validate(data, offsets, offset=col.offset, length=len(col))
+ *
+ * Build: see "Python Module" in the README.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include "cardguard.h"
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/* ---------------------
+   Buffers
+---------------------- */
+
+namespace {
+
+// A Py_buffer that is handed back when it goes out of scope
+struct BufferView {
+    Py_buffer view{};
+    bool held = false;
+
+    bool get(PyObject *obj, int flags) { return held = (PyObject_GetBuffer(obj, &view, flags) == 0); }
+    ~BufferView() {
+        if (held) PyBuffer_Release(&view);
+    }
+};
+
+// Last character of a struct-module format: "16s" -> 's', "<i" -> 'i'
+char format_code(const Py_buffer &view) {
+    if (!view.format || !*view.format) return 'B';
+    return view.format[std::strlen(view.format) - 1];
+}
+
+// Offsets as uint32: Arrow's int32 offsets as they are, or the raw bytes of
+// an Arrow Buffer (which exports itself as bytes). Unaligned ones are copied.
+bool read_offsets(const Py_buffer &view, const uint32_t *&offsets, size_t &count, std::vector<uint32_t> &copy) {
+    const char code = format_code(view);
+    if (view.itemsize == 8) {
+        PyErr_SetString(PyExc_TypeError,
+                        "64-bit offsets (a large_string column): cast it to pa.string() first");
+        return false;
+    }
+    const bool words = view.itemsize == 4 && (code == 'i' || code == 'I' || code == 'l' || code == 'L');
+    const bool raw = view.itemsize == 1 && view.len % 4 == 0;
+    if (!words && !raw) {
+        PyErr_SetString(PyExc_TypeError, "offsets must be int32/uint32 values or an Arrow offsets buffer");
+        return false;
+    }
+    count = static_cast<size_t>(view.len) / 4;
+    if (reinterpret_cast<uintptr_t>(view.buf) % alignof(uint32_t) != 0) {
+        copy.resize(count);
+        std::memcpy(copy.data(), view.buf, count * 4);
+        offsets = copy.data();
+    } else {
+        offsets = static_cast<const uint32_t *>(view.buf);
+    }
+    return true;
+}
+
+// Every card inside the data buffer? (The library checks the order; this also
+// stops a bad offset reading past the end.)
+bool offsets_in_bounds(const uint32_t *offsets, size_t n, size_t data_bytes) {
+    for (size_t i = 0; i < n; ++i)
+        if (offsets[i + 1] < offsets[i]) return false;
+    return offsets[n] <= data_bytes;
+}
+
+/* ---------------------
+   Results
+---------------------- */
+
+PyObject *new_array(size_t n, int type) {
+    npy_intp dims[1] = {static_cast<npy_intp>(n)};
+    return PyArray_SimpleNew(1, dims, type);
+}
+
+// {"valid": bool[n], "flags": uint8[n], "issuer": uint8[n], "entropy": float32[n]}
+struct ResultArrays {
+    PyObject *valid = nullptr, *flags = nullptr, *issuer = nullptr, *entropy = nullptr;
+
+    bool allocate(size_t n) {
+        valid = new_array(n, NPY_BOOL);
+        flags = new_array(n, NPY_UINT8);
+        issuer = new_array(n, NPY_UINT8);
+        entropy = new_array(n, NPY_FLOAT32);
+        return valid && flags && issuer && entropy;
+    }
+
+    // One pass from the library's 8-byte records into the four columns
+    void fill(const cg_result *results, size_t n) {
+        auto *v = static_cast<npy_bool *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(valid)));
+        auto *f = static_cast<uint8_t *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(flags)));
+        auto *s = static_cast<uint8_t *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(issuer)));
+        auto *e = static_cast<float *>(PyArray_DATA(reinterpret_cast<PyArrayObject *>(entropy)));
+        for (size_t i = 0; i < n; ++i) {
+            v[i] = (results[i].flags & CG_VALID) != 0;
+            f[i] = results[i].flags;
+            s[i] = results[i].issuer;
+            e[i] = results[i].entropy;
+        }
+    }
+
+    PyObject *to_dict() {
+        PyObject *dict = Py_BuildValue("{sOsOsOsO}", "valid", valid, "flags", flags, "issuer", issuer, "entropy",
+                                       entropy);
+        release();
+        return dict;
+    }
+
+    void release() {
+        Py_XDECREF(valid);
+        Py_XDECREF(flags);
+        Py_XDECREF(issuer);
+        Py_XDECREF(entropy);
+        valid = flags = issuer = entropy = nullptr;
+    }
+    ~ResultArrays() { release(); }
+};
+
+/* ---------------------
+   Module Functions
+---------------------- */
+
+const char kValidateDoc[] =
+    "validate(data, offsets=None, threads=0, offset=0, length=-1) -> dict of NumPy arrays\n\n"
+    "data: a 1-D NumPy bytes array (dtype S<k>), or with offsets a contiguous\n"
+    "byte buffer holding the numbers back to back (an Arrow string column's data\n"
+    "buffer), card i being data[offsets[i]:offsets[i + 1]].\n"
+    "offset, length: with offsets, validate cards offset .. offset + length - 1\n"
+    "only (length -1: to the end). Pass an Arrow array's .offset and len(): a\n"
+    "sliced array shares its parent's buffers.\n"
+    "threads: worker threads (0: one per core). The GIL is released meanwhile.\n"
+    "Returns {'valid': bool, 'flags': uint8, 'issuer': uint8, 'entropy': float32}.";
+
+PyObject *py_validate(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = {"data", "offsets", "threads", "offset", "length", nullptr};
+    PyObject *data_obj = nullptr, *offsets_obj = Py_None;
+    Py_ssize_t threads = 0, first = 0, length = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Onnn:validate", const_cast<char **>(keywords), &data_obj,
+                                     &offsets_obj, &threads, &first, &length))
+        return nullptr;
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be >= 0");
+        return nullptr;
+    }
+    if (first < 0 || length < -1) {
+        PyErr_SetString(PyExc_ValueError, "offset must be >= 0 and length >= 0 (or -1)");
+        return nullptr;
+    }
+
+    BufferView data, offsets_view;
+    const uint32_t *offsets = nullptr;
+    std::vector<uint32_t> offsets_copy;
+    size_t n = 0, width = 0, stride = 0;
+    const bool fixed = offsets_obj == Py_None;
+
+    if (fixed) {
+        // NumPy "S<k>": k bytes per card, NUL-padded, possibly strided (a column of a record array)
+        if (!data.get(data_obj, PyBUF_STRIDED_RO | PyBUF_FORMAT)) return nullptr;
+        const char code = format_code(data.view);
+        if (data.view.ndim != 1 || (code != 's' && code != 'c')) {
+            PyErr_SetString(PyExc_TypeError,
+                            code == 'w' ? "str arrays hold UCS-4 text: pass arr.astype('S') instead"
+                                        : "data must be a 1-D bytes array (dtype S<k>), or pass offsets");
+            return nullptr;
+        }
+        if (data.view.strides[0] < data.view.itemsize) {
+            PyErr_SetString(PyExc_ValueError, "data must have a positive stride of at least its item size");
+            return nullptr;
+        }
+        if (first != 0 || length != -1) {
+            PyErr_SetString(PyExc_ValueError, "offset/length go with offsets; slice the NumPy array instead");
+            return nullptr;
+        }
+        n = static_cast<size_t>(data.view.shape[0]);
+        width = static_cast<size_t>(data.view.itemsize);
+        stride = static_cast<size_t>(data.view.strides[0]);
+    } else {
+        size_t count = 0;
+        if (!data.get(data_obj, PyBUF_SIMPLE) || !offsets_view.get(offsets_obj, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) ||
+            !read_offsets(offsets_view.view, offsets, count, offsets_copy))
+            return nullptr;
+        // Rows [first, first + n) of the buffers: count - 1 rows in all
+        const size_t rows = count > 0 ? count - 1 : 0;
+        if (static_cast<size_t>(first) > rows || (length >= 0 && static_cast<size_t>(length) > rows - first)) {
+            PyErr_Format(PyExc_ValueError, "offset %zd + length %zd is past the %zu rows of offsets", first, length,
+                         rows);
+            return nullptr;
+        }
+        offsets += first;
+        n = length >= 0 ? static_cast<size_t>(length) : rows - static_cast<size_t>(first);
+    }
+
+    ResultArrays arrays;
+    if (!arrays.allocate(n)) return nullptr;
+    std::vector<cg_result> results;
+    try {
+        results.resize(n);
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+
+    // From here on only C memory is touched: let other Python threads run
+    long valid = 0;
+    Py_BEGIN_ALLOW_THREADS;
+    if (fixed) {
+        valid = cg_validate_fixed(static_cast<const char *>(data.view.buf), width, stride, n, results.data(),
+                                  static_cast<size_t>(threads));
+    } else if (n > 0 && !offsets_in_bounds(offsets, n, static_cast<size_t>(data.view.len))) {
+        valid = -1;
+    } else {
+        valid = cg_validate_batch_parallel(static_cast<const char *>(data.view.buf), offsets, n, results.data(),
+                                           static_cast<size_t>(threads));
+    }
+    if (valid >= 0) arrays.fill(results.data(), n);
+    Py_END_ALLOW_THREADS;
+
+    if (valid < 0) {
+        PyErr_SetString(PyExc_ValueError, "offsets must be non-decreasing and stay inside data");
+        return nullptr;
+    }
+    return arrays.to_dict();
+}
+
+PyObject *py_set_type(PyObject *, PyObject *arg) {
+    const char *name = PyUnicode_AsUTF8(arg);
+    if (!name) return nullptr;
+    if (cg_set_type(name) != 0) {
+        PyErr_Format(PyExc_ValueError, "unknown type '%s' (card, imei, npi, sin, gtin, iban)", name);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *py_set_policy(PyObject *, PyObject *arg) {
+    const char *text = PyUnicode_AsUTF8(arg);
+    if (!text) return nullptr;
+    char error[256];
+    if (cg_set_policy(text, error, sizeof(error)) != 0) {
+        PyErr_SetString(PyExc_ValueError, error);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyMethodDef kMethods[] = {
+    {"validate", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(py_validate)),
+     METH_VARARGS | METH_KEYWORDS, kValidateDoc},
+    {"set_type", py_set_type, METH_O,
+     "set_type(name): what the numbers are: card (default), imei, npi, sin, gtin or iban.\n"
+     "Not thread-safe: call it before validating."},
+    {"set_policy", py_set_policy, METH_O,
+     "set_policy(text): replace the decision policy (the --policy file format).\n"
+     "Not thread-safe: call it before validating."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef kModule = {
+    PyModuleDef_HEAD_INIT, "cardguard", "Batch card validation over NumPy and Arrow buffers.", -1, kMethods,
+    nullptr, nullptr, nullptr, nullptr,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_cardguard(void) {
+    import_array();
+    PyObject *module = PyModule_Create(&kModule);
+    if (!module) return nullptr;
+
+    // ISSUERS[r["issuer"][i]] is the scheme name, e.g. for pd.Categorical.from_codes
+    PyObject *issuers = PyTuple_New(CG_ISSUER_ENROUTE + 1);
+    for (int i = 0; i <= CG_ISSUER_ENROUTE; ++i)
+        PyTuple_SET_ITEM(issuers, i, PyUnicode_FromString(cg_issuer_name(static_cast<uint8_t>(i))));
+    if (PyModule_AddObject(module, "ISSUERS", issuers) != 0 || PyModule_AddIntConstant(module, "VALID", CG_VALID) ||
+        PyModule_AddIntConstant(module, "LOW_CONFIDENCE", CG_LOW_CONFIDENCE) ||
+        PyModule_AddIntConstant(module, "LENGTH_PASS", CG_LENGTH_PASS) ||
+        PyModule_AddIntConstant(module, "CHECKSUM_PASS", CG_CHECKSUM_PASS) ||
+        PyModule_AddIntConstant(module, "ENTROPY_PASS", CG_ENTROPY_PASS) ||
+        PyModule_AddIntConstant(module, "REPETITION_PASS", CG_REPETITION_PASS)) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,21 @@
+# Builds the `cardguard` extension module from the library sources:
+#     cd python && python3 setup.py build_ext --inplace   (or: make python)
+import numpy
+from setuptools import Extension, setup
+
+CORE = ["cardguard", "validator", "metrics", "policy", "mod10", "iban", "huge_pages", "numa_topology"]
+
+setup(
+    name="cardguard",
+    version="1.0",
+    ext_modules=[
+        Extension(
+            "cardguard",
+            sources=["cardguard_module.cpp"] + [f"../src/{name}.cpp" for name in CORE],
+            include_dirs=["../include", numpy.get_include()],
+            extra_compile_args=["-std=c++20", "-O2", "-fvisibility=hidden"],
+            extra_link_args=["-pthread"],
+            language="c++",
+        )
+    ],
+)
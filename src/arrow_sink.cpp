@@ -0,0 +1,368 @@
+#include "arrow_sink.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+/* ---------------------
+   Tiny FlatBuffers Builder
+---------------------- */
+
+/*
+ * Arrow's message headers are FlatBuffers. We only need to WRITE a handful
+ * of fixed shapes, so instead of pulling in the flatbuffers library this is
+ * the minimum of its builder: the buffer grows from the back towards the
+ * front (children are written before the parents that point at them), and
+ * every position is measured from the END of the buffer, so it never
+ * changes when more bytes are put in front. The writer keeps one and
+ * reset()s it per message, so its buffers stop growing after the first batch.
+ */
+class FlatBuilder {
+public:
+    FlatBuilder() : buf_(1024), head_(buf_.size()) {}
+
+    void reset() {
+        head_ = buf_.size();
+        minalign_ = 1;
+        fields_.clear();
+    }
+
+    uint32_t size() const { return static_cast<uint32_t>(buf_.size() - head_); }
+
+    template <typename T>
+    uint32_t scalar(T value) {
+        prealign(0, sizeof(T));
+        push(value);
+        return size();
+    }
+
+    uint32_t string(std::string_view text) {
+        prealign(text.size() + 1, 4);
+        push<uint8_t>(0); // FlatBuffers strings are also NUL-terminated
+        push_bytes(text.data(), text.size());
+        push<uint32_t>(static_cast<uint32_t>(text.size()));
+        return size();
+    }
+
+    // A vector of fixed-size structs (FieldNode, Buffer) copied as raw bytes
+    uint32_t struct_vector(const void *data, size_t count, size_t elem_size, size_t align) {
+        prealign(count * elem_size, 4);
+        prealign(count * elem_size, align);
+        push_bytes(data, count * elem_size);
+        push<uint32_t>(static_cast<uint32_t>(count));
+        return size();
+    }
+
+    // A vector of references to tables built earlier
+    uint32_t offset_vector(const std::vector<uint32_t> &targets) {
+        prealign(targets.size() * 4, 4);
+        for (size_t i = targets.size(); i-- > 0;) push<uint32_t>(size() + 4 - targets[i]);
+        push<uint32_t>(static_cast<uint32_t>(targets.size()));
+        return size();
+    }
+
+    void start_table() {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T>
+    void add_scalar(uint16_t id, T value) {
+        fields_.push_back({id, scalar(value)});
+    }
+
+    void add_offset(uint16_t id, uint32_t target) {
+        prealign(0, 4);
+        push<uint32_t>(size() + 4 - target);
+        fields_.push_back({id, size()});
+    }
+
+    uint32_t end_table() {
+        // The table starts with a signed offset back to its vtable (the
+        // "table of contents" saying where each field sits). Patch it once
+        // the vtable has been written just in front of the table.
+        prealign(0, 4);
+        push<int32_t>(0);
+        const uint32_t table = size();
+
+        uint16_t max_id = 0;
+        for (const auto &f : fields_) max_id = std::max<uint16_t>(max_id, static_cast<uint16_t>(f.id + 1));
+        slots_.assign(max_id, 0);
+        for (const auto &f : fields_) slots_[f.id] = static_cast<uint16_t>(table - f.position);
+
+        for (size_t i = slots_.size(); i-- > 0;) push<uint16_t>(slots_[i]);
+        push<uint16_t>(static_cast<uint16_t>(table - table_start_));
+        push<uint16_t>(static_cast<uint16_t>((slots_.size() + 2) * 2));
+        const uint32_t vtable = size();
+
+        int32_t back = static_cast<int32_t>(vtable) - static_cast<int32_t>(table);
+        std::memcpy(&buf_[buf_.size() - table], &back, sizeof(back));
+        return table;
+    }
+
+    // Write the root offset and return the finished bytes, padded to 8 for Arrow
+    std::vector<uint8_t> &finish(uint32_t root, std::vector<uint8_t> &out) {
+        prealign(4, std::max<size_t>(minalign_, 8));
+        push<uint32_t>(size() + 4 - root);
+        out.assign(buf_.begin() + static_cast<std::ptrdiff_t>(head_), buf_.end());
+        out.resize((out.size() + 7) & ~size_t(7), 0);
+        return out;
+    }
+
+private:
+    struct FieldSlot {
+        uint16_t id;
+        uint32_t position;
+    };
+
+    void reserve(size_t bytes) {
+        if (head_ >= bytes) return;
+        size_t used = size(), grown = std::max(buf_.size() * 2, used + bytes);
+        std::vector<uint8_t> bigger(grown);
+        std::memcpy(bigger.data() + grown - used, buf_.data() + head_, used);
+        buf_.swap(bigger);
+        head_ = grown - used;
+    }
+
+    void push_bytes(const void *data, size_t bytes) {
+        reserve(bytes);
+        head_ -= bytes;
+        if (bytes) std::memcpy(&buf_[head_], data, bytes);
+    }
+
+    // Arrow is little-endian and so is every machine we target
+    template <typename T>
+    void push(T value) {
+        push_bytes(&value, sizeof(T));
+    }
+
+    // Pad so that after `len` more bytes the position is a multiple of `align`
+    void prealign(size_t len, size_t align) {
+        minalign_ = std::max(minalign_, align);
+        size_t pad = (~(size() + len) + 1) & (align - 1);
+        reserve(pad);
+        while (pad--) buf_[--head_] = 0;
+    }
+
+    std::vector<uint8_t> buf_;
+    size_t head_;
+    size_t minalign_ = 1;
+    uint32_t table_start_ = 0;
+    std::vector<FieldSlot> fields_;
+    std::vector<uint16_t> slots_;
+};
+
+namespace {
+
+/* ---------------------
+   Arrow Schema Constants
+---------------------- */
+
+// Values from Arrow's Schema.fbs / Message.fbs
+constexpr int16_t kMetadataV5 = 4;
+constexpr uint8_t kHeaderSchema = 1, kHeaderDictionaryBatch = 2, kHeaderRecordBatch = 3;
+constexpr uint8_t kTypeInt = 2, kTypeFloatingPoint = 3, kTypeUtf8 = 5, kTypeBool = 6;
+constexpr int16_t kPrecisionSingle = 1;
+
+struct FieldNode {
+    int64_t length;
+    int64_t null_count;
+};
+
+struct BufferSpec {
+    int64_t offset;
+    int64_t length;
+};
+
+constexpr size_t kBoolColumns = 4;
+constexpr const char *kBoolNames[kBoolColumns] = {"valid", "low_confidence", "luhn_pass", "repetition_pass"};
+constexpr size_t kColumns = kBoolColumns + 2; // + entropy + issuer
+
+inline size_t pad8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+// Message { version, header_type, header, bodyLength }
+uint32_t build_message(FlatBuilder &fb, uint8_t header_type, uint32_t header, int64_t body_length) {
+    fb.start_table();
+    fb.add_scalar<int64_t>(3, body_length);
+    fb.add_offset(2, header);
+    fb.add_scalar<int16_t>(0, kMetadataV5);
+    fb.add_scalar<uint8_t>(1, header_type);
+    return fb.end_table();
+}
+
+// RecordBatch { length, nodes, buffers } (shared by dictionary and data batches)
+uint32_t build_record_batch(FlatBuilder &fb, int64_t rows, std::span<const FieldNode> nodes,
+                            std::span<const BufferSpec> buffers) {
+    uint32_t buffer_vec = fb.struct_vector(buffers.data(), buffers.size(), sizeof(BufferSpec), 8);
+    uint32_t node_vec = fb.struct_vector(nodes.data(), nodes.size(), sizeof(FieldNode), 8);
+    fb.start_table();
+    fb.add_scalar<int64_t>(0, rows);
+    fb.add_offset(1, node_vec);
+    fb.add_offset(2, buffer_vec);
+    return fb.end_table();
+}
+
+} // namespace
+
+/* ---------------------
+   Stream Writer
+---------------------- */
+
+ArrowStreamWriter::ArrowStreamWriter(std::ostream &out) : out_(out), builder_(std::make_unique<FlatBuilder>()) {}
+ArrowStreamWriter::~ArrowStreamWriter() = default;
+
+void ArrowStreamWriter::write_message(const std::vector<uint8_t> &metadata, const std::vector<uint8_t> &body) {
+    const uint32_t continuation = 0xFFFFFFFFu;
+    const int32_t metadata_size = static_cast<int32_t>(metadata.size());
+    out_.write(reinterpret_cast<const char *>(&continuation), 4);
+    out_.write(reinterpret_cast<const char *>(&metadata_size), 4);
+    out_.write(reinterpret_cast<const char *>(metadata.data()), static_cast<std::streamsize>(metadata.size()));
+    out_.write(reinterpret_cast<const char *>(body.data()), static_cast<std::streamsize>(body.size()));
+}
+
+void ArrowStreamWriter::write_preamble() {
+    started_ = true;
+
+    FlatBuilder &fb = *builder_;
+
+    // --- Schema ---
+    {
+        fb.reset();
+        std::vector<uint32_t> fields;
+
+        auto bool_type = [&] {
+            fb.start_table();
+            return fb.end_table();
+        };
+        auto field = [&](const char *name, uint8_t type_type, uint32_t type, uint32_t dictionary) {
+            uint32_t name_off = fb.string(name);
+            uint32_t children = fb.offset_vector({});
+            fb.start_table();
+            fb.add_offset(0, name_off);
+            fb.add_offset(3, type);
+            fb.add_offset(5, children);
+            if (dictionary) fb.add_offset(4, dictionary);
+            fb.add_scalar<uint8_t>(1, 0); // nullable = false
+            fb.add_scalar<uint8_t>(2, type_type);
+            return fb.end_table();
+        };
+
+        for (const char *name : kBoolNames) fields.push_back(field(name, kTypeBool, bool_type(), 0));
+
+        fb.start_table();
+        fb.add_scalar<int16_t>(0, kPrecisionSingle);
+        uint32_t float_type = fb.end_table();
+        fields.push_back(field("entropy", kTypeFloatingPoint, float_type, 0));
+
+        // issuer: values are utf8 strings, stored as int8 indexes into dictionary 0
+        fb.start_table();
+        fb.add_scalar<int32_t>(0, 8);   // bitWidth
+        fb.add_scalar<uint8_t>(1, 1);   // is_signed
+        uint32_t index_type = fb.end_table();
+        fb.start_table();
+        fb.add_scalar<int64_t>(0, 0);   // dictionary id
+        fb.add_offset(1, index_type);
+        uint32_t encoding = fb.end_table();
+        fb.start_table();
+        uint32_t utf8_type = fb.end_table();
+        fields.push_back(field("issuer", kTypeUtf8, utf8_type, encoding));
+
+        uint32_t field_vec = fb.offset_vector(fields);
+        fb.start_table();
+        fb.add_offset(1, field_vec);
+        fb.add_scalar<int16_t>(0, 0); // Little-endian
+        uint32_t schema = fb.end_table();
+
+        fb.finish(build_message(fb, kHeaderSchema, schema, 0), metadata_);
+        body_.clear();
+        write_message(metadata_, body_);
+    }
+
+    // --- Issuer dictionary: id -> name, in Issuer enum order ---
+    {
+        const size_t n = static_cast<size_t>(Issuer::Count);
+        std::vector<int32_t> offsets(n + 1, 0);
+        std::string names;
+        for (size_t i = 0; i < n; ++i) {
+            names += issuer_name(static_cast<Issuer>(i));
+            offsets[i + 1] = static_cast<int32_t>(names.size());
+        }
+        const size_t offsets_bytes = pad8(offsets.size() * 4);
+        body_.assign(offsets_bytes + pad8(names.size()), 0);
+        std::memcpy(body_.data(), offsets.data(), offsets.size() * 4);
+        std::memcpy(body_.data() + offsets_bytes, names.data(), names.size());
+
+        const FieldNode node[1] = {{static_cast<int64_t>(n), 0}};
+        const BufferSpec buffers[3] = {{0, 0},
+                                       {0, static_cast<int64_t>(offsets.size() * 4)},
+                                       {static_cast<int64_t>(offsets_bytes), static_cast<int64_t>(names.size())}};
+        fb.reset();
+        uint32_t batch = build_record_batch(fb, static_cast<int64_t>(n), node, buffers);
+        fb.start_table();
+        fb.add_scalar<int64_t>(0, 0); // dictionary id
+        fb.add_offset(1, batch);
+        uint32_t dictionary_batch = fb.end_table();
+        fb.finish(build_message(fb, kHeaderDictionaryBatch, dictionary_batch, static_cast<int64_t>(body_.size())), metadata_);
+        write_message(metadata_, body_);
+    }
+}
+
+void ArrowStreamWriter::write(const CardResult *results, size_t count) {
+    if (!started_) write_preamble();
+    if (count == 0) return;
+
+    // Body layout: [4 bit-packed bool columns][float32 entropy][int8 issuer ids],
+    // each buffer padded to 8 bytes. No validity bitmaps: nothing is ever null.
+    const size_t bits_bytes = pad8((count + 7) / 8);
+    const size_t float_at = kBoolColumns * bits_bytes;
+    const size_t issuer_at = float_at + pad8(count * 4);
+    body_.assign(issuer_at + pad8(count), 0);
+
+    uint8_t *bits[kBoolColumns];
+    for (size_t c = 0; c < kBoolColumns; ++c) bits[c] = body_.data() + c * bits_bytes;
+    float *entropy = reinterpret_cast<float *>(body_.data() + float_at);
+    int8_t *issuer = reinterpret_cast<int8_t *>(body_.data() + issuer_at);
+
+    // One pass over the result array straight into the Arrow buffers
+    for (size_t i = 0; i < count; ++i) {
+        const CardResult &r = results[i];
+        const uint8_t mask = static_cast<uint8_t>(1u << (i % 8));
+        if (r.valid) bits[0][i / 8] |= mask;
+        if (r.valid && r.low_confidence) bits[1][i / 8] |= mask;
+        if (r.luhn_pass) bits[2][i / 8] |= mask;
+        if (r.repetition_pass) bits[3][i / 8] |= mask;
+        entropy[i] = static_cast<float>(r.entropy);
+        issuer[i] = static_cast<int8_t>(r.issuer_id);
+    }
+
+    // Fixed shapes: one node per column, a (validity, values) buffer pair per column
+    std::array<FieldNode, kColumns> nodes;
+    nodes.fill(FieldNode{static_cast<int64_t>(count), 0});
+    std::array<BufferSpec, 2 * kColumns> buffers;
+    for (size_t c = 0; c < kBoolColumns; ++c) {
+        buffers[2 * c] = {static_cast<int64_t>(c * bits_bytes), 0};
+        buffers[2 * c + 1] = {static_cast<int64_t>(c * bits_bytes), static_cast<int64_t>((count + 7) / 8)};
+    }
+    buffers[2 * kBoolColumns] = {static_cast<int64_t>(float_at), 0};
+    buffers[2 * kBoolColumns + 1] = {static_cast<int64_t>(float_at), static_cast<int64_t>(count * 4)};
+    buffers[2 * kBoolColumns + 2] = {static_cast<int64_t>(issuer_at), 0};
+    buffers[2 * kBoolColumns + 3] = {static_cast<int64_t>(issuer_at), static_cast<int64_t>(count)};
+
+    FlatBuilder &fb = *builder_;
+    fb.reset();
+    uint32_t batch = build_record_batch(fb, static_cast<int64_t>(count), nodes, buffers);
+    fb.finish(build_message(fb, kHeaderRecordBatch, batch, static_cast<int64_t>(body_.size())), metadata_);
+    write_message(metadata_, body_);
+    rows_ += count;
+}
+
+bool ArrowStreamWriter::finish() {
+    if (!started_) write_preamble(); // An empty run is still a valid (empty) stream
+    const uint32_t end_of_stream[2] = {0xFFFFFFFFu, 0};
+    out_.write(reinterpret_cast<const char *>(end_of_stream), sizeof(end_of_stream));
+    out_.flush();
+    return static_cast<bool>(out_);
+}
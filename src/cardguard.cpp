@@ -0,0 +1,152 @@
+#include "cardguard.h"
+#include "mod10.h"
+#include "policy.h"
+#include "validator.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ---------------------
+   ABI Checks
+---------------------- */
+
+// The C names are promises about the C++ values: break one and the build stops
+static_assert(sizeof(cg_result) == 8, "cg_result is part of the ABI");
+constexpr bool same(int c_value, int cpp_value) { return c_value == cpp_value; }
+static_assert(same(CG_VALID, kFlagValid) && same(CG_LOW_CONFIDENCE, kFlagLowConfidence) &&
+                  same(CG_LENGTH_PASS, kFlagLengthPass) && same(CG_CHECKSUM_PASS, kFlagLuhnPass) &&
+                  same(CG_ENTROPY_PASS, kFlagEntropyPass) && same(CG_REPETITION_PASS, kFlagRepetitionPass),
+              "CG_* flags must match CardResultFlag");
+static_assert(same(CG_ISSUER_VISA, static_cast<int>(Issuer::Visa)) &&
+                  same(CG_ISSUER_ENROUTE, static_cast<int>(Issuer::Enroute)) &&
+                  same(CG_ISSUER_ENROUTE + 1, static_cast<int>(Issuer::Count)),
+              "CG_ISSUER_* must match Issuer");
+
+/* ---------------------
+   Validation
+---------------------- */
+
+namespace {
+
+inline cg_result to_cg_result(const CardResult &res) {
+    cg_result out;
+    out.flags = result_flags(res);
+    out.issuer = static_cast<uint8_t>(res.issuer_id);
+    out.reserved = 0;
+    out.entropy = static_cast<float>(res.entropy);
+    return out;
+}
+
+bool offsets_ok(const uint32_t *offsets, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (offsets[i + 1] < offsets[i]) return false;
+    return true;
+}
+
+// The work of one thread: cards [begin, end), straight from the caller's buffer
+template <typename CardAt>
+long validate_range(CardAt card_at, size_t begin, size_t end, cg_result *out) {
+    long valid = 0;
+    for (size_t i = begin; i < end; ++i) {
+        out[i] = to_cg_result(validate_card_quiet(card_at(i)));
+        valid += out[i].flags & CG_VALID;
+    }
+    return valid;
+}
+
+// Cards [0, n) over up to `threads` threads, one contiguous slice each: every
+// thread writes its own stretch of `out`
+template <typename CardAt>
+long validate_slices(CardAt card_at, size_t n, cg_result *out, size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // Below a couple of thousand cards per thread, starting threads costs more than it saves
+    threads = std::min(threads, std::max<size_t>(1, n / 2048));
+    if (threads == 1) return validate_range(card_at, 0, n, out);
+
+    std::vector<long> valid(threads, 0);
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t)
+        workers.emplace_back([&, t] { valid[t] = validate_range(card_at, n * t / threads, n * (t + 1) / threads, out); });
+    valid[0] = validate_range(card_at, 0, n / threads, out);
+    for (std::thread &w : workers) w.join();
+
+    long total = 0;
+    for (long v : valid) total += v;
+    return total;
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t cg_abi_version(void) { return CG_ABI_VERSION; }
+
+long cg_validate_batch(const char *buf, const uint32_t *offsets, size_t n, cg_result *out) {
+    return cg_validate_batch_parallel(buf, offsets, n, out, 1);
+}
+
+long cg_validate_batch_parallel(const char *buf, const uint32_t *offsets, size_t n, cg_result *out, size_t threads) {
+    if (n == 0) return 0;
+    if (!buf || !offsets || !out || !offsets_ok(offsets, n)) return -1;
+    return validate_slices(
+        [=](size_t i) { return std::string_view(buf + offsets[i], offsets[i + 1] - offsets[i]); }, n, out, threads);
+}
+
+long cg_validate_fixed(const char *buf, size_t width, size_t stride, size_t n, cg_result *out, size_t threads) {
+    if (n == 0) return 0;
+    if (!buf || !out || width == 0 || stride < width) return -1;
+    return validate_slices(
+        [=](size_t i) {
+            // NUL padding is not part of the number
+            const char *card = buf + i * stride;
+            size_t length = width;
+            while (length > 0 && card[length - 1] == '\0') --length;
+            return std::string_view(card, length);
+        },
+        n, out, threads);
+}
+
+int cg_validate(const char *number, size_t length, cg_result *out) {
+    const CardResult res = validate_card_quiet(number ? std::string_view(number, length) : std::string_view());
+    if (out) *out = to_cg_result(res);
+    return res.valid ? 1 : 0;
+}
+
+int cg_luhn_check(const char *digits, size_t length) {
+    if (!digits || length == 0) return 0;
+    for (size_t i = 0; i < length; ++i)
+        if (digits[i] < '0' || digits[i] > '9') return 0;
+    return luhn_check(std::string_view(digits, length)) ? 1 : 0;
+}
+
+const char *cg_issuer_name(uint8_t issuer) {
+    return issuer < static_cast<uint8_t>(Issuer::Count) ? issuer_name(static_cast<Issuer>(issuer)) : "UNKNOWN";
+}
+
+int cg_set_type(const char *name) {
+    bool ok = false;
+    const IdType type = id_type_from_name(name ? name : "", ok);
+    if (!ok) return -1;
+    set_active_id_type(type);
+    return 0;
+}
+
+int cg_set_policy(const char *text, char *error, size_t error_size) {
+    Policy policy;
+    std::string message;
+    if (!text || !policy.compile(text, message)) {
+        if (error && error_size) {
+            if (!text) message = "no policy text";
+            const size_t n = std::min(message.size(), error_size - 1);
+            std::memcpy(error, message.data(), n);
+            error[n] = '\0';
+        }
+        return -1;
+    }
+    set_active_policy(policy);
+    return 0;
+}
+
+} // extern "C"
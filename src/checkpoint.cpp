@@ -0,0 +1,104 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <zlib.h>
+
+uint32_t crc32_update(uint32_t crc, const char *data, size_t size) {
+    return static_cast<uint32_t>(crc32_z(crc, reinterpret_cast<const Bytef *>(data), size));
+}
+
+bool hash_prefix(std::istream &in, uint64_t bytes, uint32_t &crc) {
+    std::vector<char> buf(1 << 20);
+    while (bytes > 0) {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(bytes, buf.size()));
+        in.read(buf.data(), static_cast<std::streamsize>(want));
+        const size_t got = static_cast<size_t>(in.gcount());
+        crc = crc32_update(crc, buf.data(), got);
+        bytes -= got;
+        if (got < want) return false;
+    }
+    return true;
+}
+
+/* ---------------------
+   Checkpoint File
+---------------------- */
+
+bool load_checkpoint(const std::string &path, CheckpointState &state) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line) || line != "# cardguard checkpoint v1") {
+        std::cerr << "[ERROR] " << path << " is not a checkpoint file\n";
+        return false;
+    }
+    state = CheckpointState{};
+    while (std::getline(file, line)) {
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        const std::string key = line.substr(0, eq), value = line.substr(eq + 1);
+        const uint64_t number = std::strtoull(value.c_str(), nullptr, key == "crc32" ? 16 : 10);
+        if (key == "input") state.input = value;
+        else if (key == "format") state.format = value;
+        else if (key == "output") state.output = value;
+        else if (key == "offset") state.offset = number;
+        else if (key == "crc32") state.crc = static_cast<uint32_t>(number);
+        else if (key == "line") state.line = number;
+        else if (key == "total") state.total = number;
+        else if (key == "valid") state.valid = number;
+        else if (key == "low_confidence") state.low_confidence = number;
+        else if (key == "missing_field") state.missing_field = number;
+        else if (key == "output_bytes") state.output_bytes = number;
+        else if (key == "complete") state.complete = number != 0;
+    }
+    return true;
+}
+
+bool save_checkpoint(const std::string &path, const CheckpointState &state) {
+    // Write a temporary file next to the real one, then rename it over: a
+    // crash mid-write leaves the previous checkpoint intact.
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        char crc[9];
+        std::snprintf(crc, sizeof(crc), "%08x", state.crc);
+        file << "# cardguard checkpoint v1\n"
+             << "input=" << state.input << "\n"
+             << "format=" << state.format << "\n"
+             << "output=" << state.output << "\n"
+             << "offset=" << state.offset << "\n"
+             << "crc32=" << crc << "\n"
+             << "line=" << state.line << "\n"
+             << "total=" << state.total << "\n"
+             << "valid=" << state.valid << "\n"
+             << "low_confidence=" << state.low_confidence << "\n"
+             << "missing_field=" << state.missing_field << "\n"
+             << "output_bytes=" << state.output_bytes << "\n"
+             << "complete=" << (state.complete ? 1 : 0) << "\n";
+        file.flush();
+        if (!file) {
+            std::cerr << "[ERROR] Could not write checkpoint " << tmp << "\n";
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "[ERROR] Could not replace checkpoint " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool Checkpointer::save(const CheckpointState &progress) {
+    CheckpointState state = progress;
+    state.input = identity_.input;
+    state.format = identity_.format;
+    state.output = identity_.output;
+    last_save_ = std::chrono::steady_clock::now();
+    ++saves_;
+    return save_checkpoint(path_, state);
+}
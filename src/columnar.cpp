@@ -0,0 +1,250 @@
+#include "columnar.h"
+#include "huge_pages.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ---------------------
+   Writer
+---------------------- */
+
+bool ColumnarWriter::open(const std::string &path) {
+    path_ = path;
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        std::cerr << "[ERROR] Could not open " << path << " for writing\n";
+        return false;
+    }
+    // Placeholder header; the real one (with row counts) is written by finish()
+    ColumnarHeader blank{};
+    file_.write(reinterpret_cast<const char *>(&blank), sizeof(blank));
+    offset_ = sizeof(blank);
+
+    valid_bits_.assign(kColumnarRowGroup / 64, 0);
+    low_confidence_bits_.assign(kColumnarRowGroup / 64, 0);
+    issuer_.reserve(kColumnarRowGroup);
+    entropy_.reserve(kColumnarRowGroup);
+    flags_.reserve(kColumnarRowGroup);
+    return true;
+}
+
+void ColumnarWriter::append(const CardResult &res) {
+    const uint32_t r = group_rows_;
+    const uint64_t bit = uint64_t(1) << (r % 64);
+    if (res.valid) valid_bits_[r / 64] |= bit;
+    if (res.valid && res.low_confidence) low_confidence_bits_[r / 64] |= bit;
+    issuer_.push_back(static_cast<uint8_t>(res.issuer_id));
+    entropy_.push_back(quantize_entropy(res.entropy));
+    flags_.push_back(result_flags(res));
+    ++rows_;
+    if (++group_rows_ == kColumnarRowGroup) flush_group();
+}
+
+void ColumnarWriter::write(const CardResult *results, size_t count) {
+    for (size_t i = 0; i < count; ++i) append(results[i]);
+}
+
+// Pad to the next 64-byte boundary, then write one column block there
+uint64_t ColumnarWriter::write_block(const void *data, size_t bytes) {
+    static const char zeros[64] = {};
+    size_t pad = (64 - offset_ % 64) % 64;
+    file_.write(zeros, static_cast<std::streamsize>(pad));
+    offset_ += pad;
+    uint64_t at = offset_;
+    file_.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+    offset_ += bytes;
+    return at;
+}
+
+void ColumnarWriter::flush_group() {
+    if (group_rows_ == 0) return;
+    const size_t words = (group_rows_ + 63) / 64;
+
+    ColumnarGroupIndex entry{};
+    entry.first_row = rows_ - group_rows_;
+    entry.row_count = group_rows_;
+    for (size_t w = 0; w < words; ++w) {
+        entry.valid_count += static_cast<uint64_t>(__builtin_popcountll(valid_bits_[w]));
+        entry.low_confidence_count += static_cast<uint64_t>(__builtin_popcountll(low_confidence_bits_[w]));
+    }
+
+    // One strip at a time: every column of this group is contiguous on disk
+    entry.column_offset[size_t(Column::Valid)] = write_block(valid_bits_.data(), words * 8);
+    entry.column_offset[size_t(Column::LowConfidence)] = write_block(low_confidence_bits_.data(), words * 8);
+    entry.column_offset[size_t(Column::Issuer)] = write_block(issuer_.data(), issuer_.size());
+    entry.column_offset[size_t(Column::Entropy)] = write_block(entropy_.data(), entropy_.size());
+    entry.column_offset[size_t(Column::Flags)] = write_block(flags_.data(), flags_.size());
+    index_.push_back(entry);
+
+    std::fill(valid_bits_.begin(), valid_bits_.end(), 0);
+    std::fill(low_confidence_bits_.begin(), low_confidence_bits_.end(), 0);
+    issuer_.clear();
+    entropy_.clear();
+    flags_.clear();
+    group_rows_ = 0;
+}
+
+bool ColumnarWriter::finish() {
+    if (!file_.is_open()) return false;
+    flush_group();
+
+    ColumnarHeader header{};
+    std::memcpy(header.magic, kColumnarMagic, sizeof(header.magic));
+    header.version = kColumnarVersion;
+    header.row_group_size = kColumnarRowGroup;
+    header.row_count = rows_;
+    header.group_count = index_.size();
+    header.index_offset = write_block(index_.data(), index_.size() * sizeof(ColumnarGroupIndex));
+
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file_.close();
+    if (!file_) {
+        std::cerr << "[ERROR] Writing " << path_ << " failed\n";
+        return false;
+    }
+    return true;
+}
+
+/* ---------------------
+   Reader
+---------------------- */
+
+ColumnarReader::~ColumnarReader() {
+    if (base_) ::munmap(const_cast<uint8_t *>(base_), size_);
+}
+
+bool ColumnarReader::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[ERROR] Could not open " << path << "\n";
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ColumnarHeader)) {
+        std::cerr << "[ERROR] " << path << " is too small to be a columnar result file\n";
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map " << path << "\n";
+        return false;
+    }
+    advise_huge_mapping(map, size_);
+    base_ = static_cast<const uint8_t *>(map);
+    header_ = reinterpret_cast<const ColumnarHeader *>(base_);
+
+    // Version 1 rounded entropy to the nearest 1/32, which the cutoffs below
+    // would miscount, so an old file has to be written again
+    bool ok = std::memcmp(header_->magic, kColumnarMagic, sizeof(kColumnarMagic)) == 0;
+    if (ok && header_->version != kColumnarVersion) {
+        std::cerr << "[ERROR] " << path << " is columnar format version " << header_->version << ", expected "
+                  << kColumnarVersion << "; regenerate it with --columnar-out\n";
+        ::munmap(const_cast<uint8_t *>(base_), size_);
+        base_ = nullptr;
+        header_ = nullptr;
+        return false;
+    }
+
+    // Check every offset before trusting it: a truncated file must not crash us
+    ok = ok && header_->index_offset <= size_ &&
+         header_->group_count <= (size_ - header_->index_offset) / sizeof(ColumnarGroupIndex);
+    if (ok) {
+        index_ = reinterpret_cast<const ColumnarGroupIndex *>(base_ + header_->index_offset);
+        for (size_t g = 0; ok && g < header_->group_count; ++g) {
+            const uint64_t rows = index_[g].row_count;
+            for (size_t c = 0; c < kColumnCount; ++c) {
+                bool is_bits = c == size_t(Column::Valid) || c == size_t(Column::LowConfidence);
+                uint64_t len = is_bits ? (rows + 63) / 64 * 8 : rows;
+                const uint64_t at = index_[g].column_offset[c];
+                if (at > size_ || len > size_ - at || at % 64 != 0) ok = false;
+            }
+        }
+    }
+    if (!ok) {
+        std::cerr << "[ERROR] " << path << " is not a valid columnar result file\n";
+        ::munmap(const_cast<uint8_t *>(base_), size_);
+        base_ = nullptr;
+        header_ = nullptr;
+        index_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+const uint64_t *ColumnarReader::bits(size_t g, Column column) const {
+    return reinterpret_cast<const uint64_t *>(base_ + index_[g].column_offset[size_t(column)]);
+}
+
+const uint8_t *ColumnarReader::bytes(size_t g, Column column) const {
+    return base_ + index_[g].column_offset[size_t(column)];
+}
+
+uint64_t ColumnarReader::count_set(Column column) const {
+    uint64_t total = 0;
+    for (size_t g = 0; g < group_count(); ++g) {
+        const uint64_t *words = bits(g, column);
+        const size_t n = (index_[g].row_count + 63) / 64;
+        for (size_t w = 0; w < n; ++w) total += static_cast<uint64_t>(__builtin_popcountll(words[w]));
+    }
+    return total;
+}
+
+std::array<uint64_t, 256> ColumnarReader::issuer_histogram() const {
+    std::array<uint64_t, 256> counts{};
+    for (size_t g = 0; g < group_count(); ++g) {
+        const uint8_t *ids = bytes(g, Column::Issuer);
+        for (uint64_t r = 0; r < index_[g].row_count; ++r) counts[ids[r]]++;
+    }
+    return counts;
+}
+
+uint64_t ColumnarReader::count_entropy_below(double threshold) const {
+    // entropy < threshold  <=>  floor(entropy * 32) < ceil(threshold * 32), when threshold * 32 is whole
+    const double scaled = std::ceil(threshold * 32.0);
+    const unsigned cutoff = scaled <= 0 ? 0 : scaled >= 256 ? 256 : static_cast<unsigned>(scaled);
+    uint64_t total = 0;
+    for (size_t g = 0; g < group_count(); ++g) {
+        const uint8_t *q = bytes(g, Column::Entropy);
+        for (uint64_t r = 0; r < index_[g].row_count; ++r) total += q[r] < cutoff;
+    }
+    return total;
+}
+
+/* ---------------------
+   --columnar-scan
+---------------------- */
+
+int run_columnar_scan(const std::string &path) {
+    ColumnarReader reader;
+    if (!reader.open(path)) return 1;
+
+    auto start_time = std::chrono::steady_clock::now();
+    const uint64_t low_confidence = reader.count_set(Column::LowConfidence);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    const uint64_t rows = reader.rows();
+    const uint64_t valid = reader.count_set(Column::Valid);
+    std::cout << "[INFO] " << rows << " rows in " << reader.group_count() << " row group(s)\n";
+    std::cout << "[RESULT] " << (valid - low_confidence) << " valid, " << low_confidence
+              << " valid (low confidence), " << (rows - valid) << " invalid\n";
+
+    const auto issuers = reader.issuer_histogram();
+    for (size_t id = 0; id < issuers.size(); ++id) {
+        if (issuers[id] == 0) continue;
+        const char *name = id < size_t(Issuer::Count) ? issuer_name(static_cast<Issuer>(id)) : "UNKNOWN";
+        std::cout << "[INFO] Issuer " << name << ": " << issuers[id] << "\n";
+    }
+    std::cout << "[INFO] Entropy below 3.5 bits/digit: " << reader.count_entropy_below(3.5) << "\n";
+    std::cout << "[TIME] Low-confidence popcount scan took " << ns << " ns\n";
+    return 0;
+}
@@ -0,0 +1,406 @@
+#include "compressed_input.h"
+#include "huge_pages.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr size_t kPieceBytes = 1 << 20; // Streaming decoder output per window slot
+
+inline bool is_gzip(const uint8_t *p, size_t n) {
+    return n >= 2 && p[0] == 0x1f && p[1] == 0x8b;
+}
+
+// BGZF (bgzip) stores each member's compressed size in a "BC" extra field,
+// which lets us find every member without inflating anything. Returns the
+// member size, or 0 if this member isn't BGZF.
+size_t bgzf_member_size(const uint8_t *p, size_t n) {
+    if (n < 18 || !is_gzip(p, n) || p[2] != 8 || !(p[3] & 4)) return 0;
+    const size_t xlen = p[10] | size_t(p[11]) << 8;
+    for (size_t at = 12; at + 4 <= 12 + xlen && at + 4 <= n;) {
+        const size_t slen = p[at + 2] | size_t(p[at + 3]) << 8;
+        if (p[at] == 'B' && p[at + 1] == 'C' && slen == 2 && at + 6 <= n) {
+            const size_t member = (p[at + 4] | size_t(p[at + 5]) << 8) + 1;
+            return member <= n ? member : 0;
+        }
+        at += 4 + slen;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+// One decompression context per decoder thread, reused for every frame
+ZSTD_DCtx *thread_dctx() {
+    thread_local struct Holder {
+        ZSTD_DCtx *ctx = ZSTD_createDCtx();
+        ~Holder() { ZSTD_freeDCtx(ctx); }
+    } holder;
+    return holder.ctx;
+}
+#endif
+
+} // namespace
+
+Compression detect_compression(const void *data, size_t size) {
+    const auto *p = static_cast<const uint8_t *>(data);
+    if (is_gzip(p, size)) return Compression::Gzip;
+    if (size >= 4 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd && p[0] == 0x28) return Compression::Zstd;
+    if (size >= 4 && (p[0] & 0xf0) == 0x50 && p[1] == 0x2a && p[2] == 0x4d && p[3] == 0x18)
+        return Compression::Zstd; // Starts with a zstd skippable frame
+    return Compression::None;
+}
+
+const char *compression_name(Compression compression) {
+    switch (compression) {
+    case Compression::Gzip: return "gzip";
+    case Compression::Zstd: return "zstd";
+    default: return "none";
+    }
+}
+
+/* ---------------------
+   Opening and Indexing
+---------------------- */
+
+CompressedInput::~CompressedInput() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    consumed_.notify_all();
+    produced_.notify_all();
+    for (auto &t : decoders_) t.join();
+    if (base_) ::munmap(const_cast<uint8_t *>(base_), size_);
+}
+
+bool CompressedInput::open(const std::string &path, size_t threads) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[ERROR] Could not open " << path << "\n";
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "[ERROR] Could not read " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map " << path << "\n";
+        return false;
+    }
+    base_ = static_cast<const uint8_t *>(map);
+    ::madvise(map, size_, MADV_SEQUENTIAL);
+    advise_huge_mapping(map, size_);
+
+    compression_ = detect_compression(base_, size_);
+    if (compression_ == Compression::None) {
+        std::cerr << "[ERROR] " << path << " is not gzip or zstd compressed\n";
+        return false;
+    }
+#ifndef HAVE_ZSTD
+    if (compression_ == Compression::Zstd) {
+        std::cerr << "[ERROR] " << path << " is zstd compressed, but this build has no zstd support"
+                  << " (build with -DHAVE_ZSTD and link -lzstd)\n";
+        return false;
+    }
+#endif
+    if (!index_frames()) {
+        std::cerr << "[ERROR] " << path << " is not a valid " << compression_name(compression_) << " file\n";
+        return false;
+    }
+
+    // Several independent frames: one decoder per thread, each taking whole
+    // frames. Otherwise one decoder streams the single frame piece by piece.
+    if (frames_.size() > 1) {
+        const size_t n = std::max<size_t>(1, std::min(threads, frames_.size()));
+        window_.resize(2 * n);
+        total_pieces_ = frames_.size();
+        for (size_t t = 0; t < n; ++t) decoders_.emplace_back(&CompressedInput::parallel_decoder, this);
+    } else {
+        window_.resize(2);
+        decoders_.emplace_back(&CompressedInput::streaming_decoder, this);
+    }
+    return true;
+}
+
+bool CompressedInput::index_frames() {
+    frames_.clear();
+    if (compression_ == Compression::Gzip) {
+        // All BGZF members: each one is a frame. Anything else is one gzip stream.
+        for (size_t at = 0; at < size_;) {
+            const size_t member = bgzf_member_size(base_ + at, size_ - at);
+            if (member == 0) {
+                frames_.assign(1, Frame{0, size_});
+                return true;
+            }
+            frames_.push_back({at, member});
+            at += member;
+        }
+        return true;
+    }
+#ifdef HAVE_ZSTD
+    for (size_t at = 0; at < size_;) {
+        const size_t frame = ZSTD_findFrameCompressedSize(base_ + at, size_ - at);
+        if (ZSTD_isError(frame)) return false;
+        frames_.push_back({at, frame});
+        at += frame;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* ---------------------
+   Decoders
+---------------------- */
+
+CompressedInput::Slot *CompressedInput::claim_slot(uint64_t piece) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    consumed_.wait(lock, [&] { return stop_ || piece < next_piece_ + window_.size(); });
+    if (stop_) return nullptr;
+    return &window_[piece % window_.size()];
+}
+
+void CompressedInput::publish(uint64_t piece) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot &slot = window_[piece % window_.size()];
+        slot.ready = true;
+        decompressed_bytes_ += slot.data.size();
+    }
+    produced_.notify_all();
+}
+
+void CompressedInput::fail(const std::string &error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!failed_.load(std::memory_order_relaxed)) error_ = error;
+        failed_.store(true, std::memory_order_release);
+        stop_ = true;
+    }
+    consumed_.notify_all();
+    produced_.notify_all();
+}
+
+// Decode one whole, independent frame (a BGZF member or a zstd frame)
+bool CompressedInput::decode_frame(const Frame &frame, std::vector<char> &out, std::string &error) const {
+    const uint8_t *src = base_ + frame.offset;
+    if (compression_ == Compression::Gzip) {
+        // The member trailer holds the decompressed size (BGZF members are <= 64 KiB)
+        const size_t isize = src[frame.size - 4] | size_t(src[frame.size - 3]) << 8 |
+                             size_t(src[frame.size - 2]) << 16 | size_t(src[frame.size - 1]) << 24;
+        if (isize > 65536) {
+            error = "oversized BGZF member at byte " + std::to_string(frame.offset);
+            return false;
+        }
+        out.resize(isize);
+        z_stream zs{};
+        if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+            error = "zlib initialisation failed";
+            return false;
+        }
+        zs.next_in = const_cast<Bytef *>(src);
+        zs.avail_in = static_cast<uInt>(frame.size);
+        zs.next_out = reinterpret_cast<Bytef *>(out.data());
+        zs.avail_out = static_cast<uInt>(isize);
+        const int rc = inflate(&zs, Z_FINISH);
+        const bool ok = rc == Z_STREAM_END && zs.total_out == isize;
+        inflateEnd(&zs);
+        if (!ok) error = "corrupt gzip member at byte " + std::to_string(frame.offset);
+        return ok;
+    }
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *dctx = thread_dctx();
+    const unsigned long long content = ZSTD_getFrameContentSize(src, frame.size);
+    if (content != ZSTD_CONTENTSIZE_UNKNOWN && content != ZSTD_CONTENTSIZE_ERROR) {
+        out.resize(content);
+        const size_t got = ZSTD_decompressDCtx(dctx, out.data(), out.size(), src, frame.size);
+        if (!ZSTD_isError(got) && got == content) return true;
+    } else {
+        // The writer didn't record the size: grow the buffer as we go
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+        out.resize(std::max<size_t>(ZSTD_DStreamOutSize(), frame.size * 4));
+        ZSTD_inBuffer in{src, frame.size, 0};
+        size_t filled = 0;
+        for (;;) {
+            ZSTD_outBuffer o{out.data() + filled, out.size() - filled, 0};
+            const size_t rc = ZSTD_decompressStream(dctx, &o, &in);
+            if (ZSTD_isError(rc)) break;
+            filled += o.pos;
+            if (rc == 0) {
+                out.resize(filled);
+                return true;
+            }
+            if (filled == out.size()) out.resize(out.size() * 2);
+            else if (in.pos == in.size) break; // Truncated frame
+        }
+    }
+    error = "corrupt zstd frame at byte " + std::to_string(frame.offset);
+#else
+    (void)out;
+    error = "no zstd support";
+#endif
+    return false;
+}
+
+void CompressedInput::parallel_decoder() {
+    std::string error;
+    for (;;) {
+        uint64_t piece;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            piece = next_claim_++;
+        }
+        if (piece >= frames_.size()) return;
+        Slot *slot = claim_slot(piece);
+        if (!slot) return;
+        if (!decode_frame(frames_[piece], slot->data, error)) {
+            fail(error);
+            return;
+        }
+        publish(piece);
+    }
+}
+
+void CompressedInput::streaming_decoder() {
+    uint64_t piece = 0;
+    size_t in_pos = 0;
+    bool done = false;
+
+    if (compression_ == Compression::Gzip) {
+        z_stream zs{};
+        if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+            fail("zlib initialisation failed");
+            return;
+        }
+        while (!done) {
+            Slot *slot = claim_slot(piece);
+            if (!slot) break;
+            slot->data.resize(kPieceBytes);
+            zs.next_out = reinterpret_cast<Bytef *>(slot->data.data());
+            zs.avail_out = static_cast<uInt>(kPieceBytes);
+            while (zs.avail_out > 0) {
+                if (zs.avail_in == 0) {
+                    // zlib counts in 32 bits: feed a huge file 1 GiB at a time
+                    const size_t feed = std::min<size_t>(size_ - in_pos, size_t(1) << 30);
+                    zs.next_in = const_cast<Bytef *>(base_ + in_pos);
+                    zs.avail_in = static_cast<uInt>(feed);
+                    in_pos += feed;
+                }
+                const int rc = inflate(&zs, Z_NO_FLUSH);
+                if (rc == Z_BUF_ERROR) {
+                    fail("truncated gzip stream");
+                    inflateEnd(&zs);
+                    return;
+                }
+                if (rc == Z_STREAM_END) {
+                    // Concatenated .gz files are one file: carry on with the next member
+                    const size_t next = in_pos - zs.avail_in;
+                    if (is_gzip(base_ + next, size_ - next)) {
+                        inflateReset(&zs);
+                        continue;
+                    }
+                    done = true; // Anything after the last member (padding) is ignored
+                    break;
+                }
+                if (rc != Z_OK) {
+                    fail("corrupt gzip stream");
+                    inflateEnd(&zs);
+                    return;
+                }
+            }
+            slot->data.resize(kPieceBytes - zs.avail_out);
+            publish(piece++);
+        }
+        inflateEnd(&zs);
+    } else {
+#ifdef HAVE_ZSTD
+        ZSTD_DCtx *dctx = thread_dctx();
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+        ZSTD_inBuffer in{base_, size_, 0};
+        size_t last_rc = 0;
+        while (!done) {
+            Slot *slot = claim_slot(piece);
+            if (!slot) break;
+            slot->data.resize(kPieceBytes);
+            ZSTD_outBuffer out{slot->data.data(), slot->data.size(), 0};
+            while (out.pos < out.size) {
+                // last_rc == 0: the previous frame is complete and fully flushed
+                if (in.pos == in.size && last_rc == 0) {
+                    done = true;
+                    break;
+                }
+                const size_t in_before = in.pos, out_before = out.pos;
+                last_rc = ZSTD_decompressStream(dctx, &out, &in);
+                if (ZSTD_isError(last_rc)) {
+                    fail(std::string("corrupt zstd stream: ") + ZSTD_getErrorName(last_rc));
+                    return;
+                }
+                if (in.pos == in_before && out.pos == out_before) {
+                    fail("truncated zstd stream");
+                    return;
+                }
+            }
+            slot->data.resize(out.pos);
+            publish(piece++);
+        }
+        (void)in_pos;
+#else
+        (void)in_pos;
+        fail("no zstd support");
+        return;
+#endif
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        total_pieces_ = piece;
+    }
+    produced_.notify_all();
+}
+
+/* ---------------------
+   Reader Side
+---------------------- */
+
+// The istream ran out of bytes: release the piece we were reading and wait
+// for the next one in order. Empty pieces (a BGZF end marker, a skippable
+// zstd frame) are stepped over.
+CompressedInput::int_type CompressedInput::underflow() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (holding_) {
+            window_[next_piece_ % window_.size()].ready = false;
+            ++next_piece_;
+            holding_ = false;
+            consumed_.notify_all();
+        }
+        produced_.wait(lock, [&] {
+            return stop_ || next_piece_ >= total_pieces_ || window_[next_piece_ % window_.size()].ready;
+        });
+        if (stop_ || next_piece_ >= total_pieces_) {
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        holding_ = true;
+        Slot &slot = window_[next_piece_ % window_.size()];
+        if (slot.data.empty()) continue;
+        char *p = slot.data.data();
+        setg(p, p, p + slot.data.size());
+        return traits_type::to_int_type(*p);
+    }
+}
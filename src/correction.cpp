@@ -0,0 +1,157 @@
+#include "correction.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+/* ---------------------
+   Helper Tables
+---------------------- */
+
+namespace {
+
+// The reverse of kLuhnContribution: kLuhnInverse[doubled][c] is the digit that adds c
+constexpr std::array<std::array<uint8_t, 10>, 2> kLuhnInverse = [] {
+    std::array<std::array<uint8_t, 10>, 2> table{};
+    for (size_t doubled = 0; doubled < 2; ++doubled)
+        for (uint8_t digit = 0; digit < 10; ++digit) table[doubled][kLuhnContribution[doubled][digit]] = digit;
+    return table;
+}();
+
+bool all_digits(std::string_view text) {
+    for (char c : text)
+        if (c < '0' || c > '9') return false;
+    return true;
+}
+
+} // namespace
+
+/* ---------------------
+   Check Digit
+---------------------- */
+
+int luhn_check_digit(std::string_view partial) {
+    const size_t n = partial.size();
+    if (n == 0 || n >= kMaxPanDigits || !all_digits(partial)) return -1;
+
+    // In the finished number the check digit is position 0 from the right, so
+    // partial[j] sits at position n - j: doubled when that is odd
+    unsigned sum = 0;
+    for (size_t j = 0; j < n; ++j) sum += kLuhnContribution[(n - j) & 1][partial[j] - '0'];
+    return int((10 - sum % 10) % 10);
+}
+
+/* ---------------------
+   Suggestions
+---------------------- */
+
+size_t suggest_corrections(std::string_view number, Correction *out) {
+    const size_t n = number.size();
+    if (n == 0 || n > kMaxPanDigits || !all_digits(number)) return 0;
+
+    const Issuer original = detect_issuer_id(number);
+    if (!issuer_rule(original).luhn_required()) return 0; // Nothing to correct against
+
+    // Each digit's contribution to the sum, worked out once
+    uint8_t digit[kMaxPanDigits], doubled[kMaxPanDigits], contribution[kMaxPanDigits];
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        digit[i] = uint8_t(number[i] - '0');
+        doubled[i] = uint8_t((n - 1 - i) & 1);
+        contribution[i] = kLuhnContribution[doubled[i]][digit[i]];
+        sum += contribution[i];
+    }
+    const unsigned off = sum % 10;
+    if (off == 0) return 0; // Already passes
+
+    // Candidates are built in place in `out` and kept only if the issuer rules
+    // accept them. An edit past the 4-digit prefix can't change the issuer, so
+    // only prefix edits look it up again.
+    size_t count = 0;
+    const IssuerRule original_rule = issuer_rule(original);
+    auto candidate = [&](size_t position, EditKind kind) -> Correction & {
+        Correction &c = out[count];
+        std::memcpy(c.digits, number.data(), n);
+        c.length = uint8_t(n);
+        c.position = uint8_t(position);
+        c.kind = kind;
+        return c;
+    };
+    auto keep = [&](Correction &c, size_t first_changed) {
+        c.issuer = first_changed < 4 ? detect_issuer_id(c.number()) : original;
+        const IssuerRule rule = c.issuer == original ? original_rule : issuer_rule(c.issuer);
+        if (!rule.allows(n) || !rule.luhn_required()) return;
+        c.same_issuer = c.issuer == original;
+        ++count;
+    };
+
+    // Adjacent swaps: take both old contributions out, put both new ones in
+    for (size_t i = 0; i + 1 < n; ++i) {
+        if (digit[i] == digit[i + 1]) continue;
+        const unsigned swapped = kLuhnContribution[doubled[i]][digit[i + 1]] +
+                                 kLuhnContribution[doubled[i + 1]][digit[i]];
+        if ((sum + swapped + 20 - contribution[i] - contribution[i + 1]) % 10 != 0) continue;
+        Correction &c = candidate(i, EditKind::Transposition);
+        std::swap(c.digits[i], c.digits[i + 1]);
+        keep(c, i);
+    }
+
+    // Single typos: at position i the sum needs a contribution of
+    // (contribution[i] - off) mod 10, and exactly one digit provides it
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t wanted = uint8_t((contribution[i] + 10 - off) % 10);
+        Correction &c = candidate(i, EditKind::Substitution);
+        c.digits[i] = char('0' + kLuhnInverse[doubled[i]][wanted]);
+        keep(c, i);
+    }
+
+    // Suggestions that keep the card's scheme are the likelier ones
+    std::stable_partition(out, out + count, [](const Correction &c) { return c.same_issuer; });
+    return count;
+}
+
+/* ---------------------
+   Command Line
+---------------------- */
+
+int run_suggest(std::string_view number) {
+    if (number.empty() || number.size() > kMaxPanDigits || !all_digits(number)) {
+        std::cerr << "[ERROR] --suggest needs 1 to " << kMaxPanDigits << " digits\n";
+        return 1;
+    }
+    Correction corrections[kMaxCorrections];
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t count = suggest_corrections(number, corrections);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
+                  .count();
+
+    if (luhn_check(number)) {
+        std::cout << "[RESULT] " << number << " already passes Luhn\n";
+    } else if (!issuer_rule(detect_issuer_id(number)).luhn_required()) {
+        std::cout << "[RESULT] " << issuer_name(detect_issuer_id(number)) << " numbers have no check digit\n";
+    } else {
+        std::cout << "[INFO] " << number << " fails Luhn; " << count << " suggestion(s)\n";
+        for (size_t i = 0; i < count; ++i) {
+            const Correction &c = corrections[i];
+            std::cout << "[RESULT] " << c.number() << "  ";
+            if (c.kind == EditKind::Transposition)
+                std::cout << "swap digits " << c.position + 1 << "-" << c.position + 2;
+            else
+                std::cout << "digit " << c.position + 1 << ": " << number[c.position] << " -> " << c.digits[c.position];
+            std::cout << " (" << issuer_name(c.issuer) << ")\n";
+        }
+    }
+    std::cout << "[TIME] Suggestions computed in " << ns << " ns\n";
+    return 0;
+}
+
+int run_check_digit(std::string_view partial) {
+    const int check = luhn_check_digit(partial);
+    if (check < 0) {
+        std::cerr << "[ERROR] --check-digit needs 1 to " << kMaxPanDigits - 1 << " digits\n";
+        return 1;
+    }
+    std::cout << "[RESULT] Check digit " << check << ": " << partial << check << "\n";
+    return 0;
+}
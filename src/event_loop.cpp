@@ -0,0 +1,183 @@
+#include "event_loop.h"
+#include <cstdlib>
+#include <new>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/* ---------------------
+   Coroutine Frames
+---------------------- */
+
+namespace {
+
+std::atomic<size_t> g_frames_live{0};
+std::atomic<size_t> g_frame_bytes_max{0};
+
+} // namespace
+
+void *DetachedTask::promise_type::operator new(size_t size) {
+    g_frames_live.fetch_add(1, std::memory_order_relaxed);
+    size_t seen = g_frame_bytes_max.load(std::memory_order_relaxed);
+    while (size > seen && !g_frame_bytes_max.compare_exchange_weak(seen, size, std::memory_order_relaxed)) {}
+    return ::operator new(size);
+}
+
+void DetachedTask::promise_type::operator delete(void *frame, size_t size) {
+    g_frames_live.fetch_sub(1, std::memory_order_relaxed);
+    ::operator delete(frame, size);
+}
+
+size_t coroutine_frames_live() { return g_frames_live.load(std::memory_order_relaxed); }
+
+size_t coroutine_frame_bytes_max() { return g_frame_bytes_max.load(std::memory_order_relaxed); }
+
+/* ---------------------
+   Event Loop
+---------------------- */
+
+EventLoop::EventLoop() {
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ >= 0 && wake_ >= 0) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // The one registration that isn't a socket
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &ev);
+    }
+}
+
+EventLoop::~EventLoop() {
+    close_all();
+    if (wake_ >= 0) ::close(wake_);
+    if (epoll_ >= 0) ::close(epoll_);
+}
+
+void EventLoop::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        posted_.push_back(handle);
+    }
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_, &one, sizeof(one));
+}
+
+void EventLoop::run(const std::atomic<bool> &stop) {
+    epoll_event events[64];
+    while (!stop.load(std::memory_order_relaxed)) {
+        // The timeout is only there to notice `stop`
+        const int n = ::epoll_wait(epoll_, events, 64, 100);
+        for (int i = 0; i < n; ++i) {
+            auto *sock = static_cast<AsyncSocket *>(events[i].data.ptr);
+            if (!sock) {
+                uint64_t count;
+                [[maybe_unused]] ssize_t r = ::read(wake_, &count, sizeof(count));
+                continue;
+            }
+            // A coroutine waits for one direction at a time, and resuming it
+            // may end it (and free `sock`), so take the handle out first
+            const uint32_t e = events[i].events;
+            std::coroutine_handle<> h;
+            if ((e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && sock->reader_) std::swap(h, sock->reader_);
+            else if ((e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && sock->writer_) std::swap(h, sock->writer_);
+            if (h) h.resume();
+        }
+
+        // Coroutines handed back by compute threads (or yielding)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_.swap(posted_);
+        }
+        for (std::coroutine_handle<> h : running_) h.resume();
+        running_.clear();
+    }
+}
+
+void EventLoop::close_all() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.swap(posted_);
+    }
+    for (std::coroutine_handle<> h : running_) h.destroy();
+    running_.clear();
+
+    // Destroying a frame runs ~AsyncSocket, which unlinks it from the list
+    while (sockets_) {
+        AsyncSocket *sock = sockets_;
+        std::coroutine_handle<> h = sock->reader_ ? sock->reader_ : sock->writer_;
+        if (h) {
+            h.destroy();
+        } else {
+            sockets_ = sock->next_;
+            if (sockets_) sockets_->prev_ = nullptr;
+            sock->prev_ = sock->next_ = nullptr;
+            sock->registered_ = false;
+        }
+    }
+}
+
+/* ---------------------
+   Sockets
+---------------------- */
+
+AsyncSocket::AsyncSocket(EventLoop &loop, int fd) : loop_(loop), fd_(fd) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = this;
+    if (::epoll_ctl(loop_.epoll_, EPOLL_CTL_ADD, fd_, &ev) != 0) return;
+    registered_ = true;
+    next_ = loop_.sockets_;
+    if (next_) next_->prev_ = this;
+    loop_.sockets_ = this;
+}
+
+AsyncSocket::~AsyncSocket() {
+    if (registered_) {
+        if (prev_) prev_->next_ = next_;
+        else loop_.sockets_ = next_;
+        if (next_) next_->prev_ = prev_;
+    }
+    ::close(fd_); // Also removes it from the epoll set
+}
+
+/* ---------------------
+   Compute Pool
+---------------------- */
+
+ComputePool::ComputePool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) threads_.emplace_back(&ComputePool::work, this);
+}
+
+ComputePool::~ComputePool() { stop(); }
+
+void ComputePool::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(handle);
+    }
+    ready_.notify_one();
+}
+
+void ComputePool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread &t : threads_) t.join();
+    threads_.clear();
+}
+
+void ComputePool::work() {
+    for (;;) {
+        std::coroutine_handle<> h;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // Stopping, and nothing left to finish
+            h = queue_.front();
+            queue_.pop_front();
+        }
+        h.resume();
+    }
+}
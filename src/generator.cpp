@@ -0,0 +1,298 @@
+#include "generator.h"
+#include "huge_pages.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ---------------------
+   Counter-based RNG
+---------------------- */
+
+namespace {
+
+// wyrand: its state just steps by a constant, so the n-th output can be
+// computed directly from (seed + n * step) -- no sequence to walk through.
+constexpr uint64_t kWyStep = 0xa0761d6478bd642full;
+constexpr uint64_t kWyMix = 0xe7037ed1a0b428dbull;
+
+inline uint64_t wyrand_at(uint64_t seed, uint64_t counter) {
+    uint64_t state = seed + (counter + 1) * kWyStep;
+    __uint128_t m = static_cast<__uint128_t>(state) * (state ^ kWyMix);
+    return static_cast<uint64_t>(m >> 64) ^ static_cast<uint64_t>(m);
+}
+
+/* ---------------------
+   Prefix Tables
+---------------------- */
+
+// One issuer prefix, ready to copy, with its share of the Luhn sum for the
+// configured length already added up
+struct Prefix {
+    char digits[4];
+    uint32_t luhn_sum;
+};
+
+// Does the digit at `index` (from the left) of a `length`-digit number get doubled?
+// Luhn doubles every second digit counting from the check digit on the right.
+inline bool doubled(size_t index, size_t length) {
+    return (length - 1 - index) % 2 == 1;
+}
+
+std::vector<std::vector<Prefix>> build_prefixes(const GeneratorOptions &options) {
+    std::vector<std::vector<Prefix>> tables;
+    for (Issuer issuer : options.issuers) {
+        std::vector<Prefix> table;
+        for (const IssuerPrefixRange &range : issuer_prefix_ranges()) {
+            if (range.issuer != issuer) continue;
+            for (unsigned p = range.first; p <= range.last; ++p) {
+                Prefix prefix{};
+                unsigned value = p;
+                for (size_t i = 4; i-- > 0; value /= 10) prefix.digits[i] = char('0' + value % 10);
+                for (size_t i = 0; i < 4; ++i) {
+                    unsigned d = unsigned(prefix.digits[i] - '0');
+                    prefix.luhn_sum += kLuhnContribution[doubled(i, options.length)][d];
+                }
+                table.push_back(prefix);
+            }
+        }
+        tables.push_back(std::move(table));
+    }
+    return tables;
+}
+
+/* ---------------------
+   The Press
+---------------------- */
+
+// Stamp rows [first, last) into `out` (row r lives at (r - first) * (length + 1))
+void generate_rows(const GeneratorOptions &options, const std::vector<std::vector<Prefix>> &prefixes,
+                   char *out, uint64_t first, uint64_t last) {
+    const size_t length = options.length;
+    const size_t body = length - 5; // 4 prefix digits + body + 1 check digit
+    const uint32_t issuers = static_cast<uint32_t>(prefixes.size());
+    const unsigned k = options.entropy_digits;
+    const uint32_t repeat_below = static_cast<uint32_t>(options.repeat_fraction * 16777216.0); // Out of 2^24
+    const uint64_t seed = options.seed;
+
+    // Everything the loop reads lives in locals: the rows are written through a
+    // char pointer, which may alias anything, so a field read through
+    // `options` or a vector would be reloaded after every digit stored
+    struct Table {
+        const Prefix *prefixes;
+        uint64_t size;
+    };
+    std::vector<Table> table_list(issuers);
+    for (uint32_t t = 0; t < issuers; ++t) table_list[t] = {prefixes[t].data(), prefixes[t].size()};
+    const Table *tables = table_list.data();
+
+    // Which body positions are doubled never changes for a fixed length, and
+    // it alternates, so digits come in pairs: the first of each pair always
+    // adds from row `even` of kLuhnContribution, the second from row `odd`
+    const uint8_t *even = kLuhnContribution[doubled(4, length)];
+    const uint8_t *odd = kLuhnContribution[doubled(5, length)];
+
+    // Digit d rotated onto the k-digit alphabet: kRotated[rotate + d]
+    static constexpr uint8_t kRotated[20] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    // Two base-k digits at once: floor(h * k^2 / 2^32) is exactly k * d1 + d2
+    // for the next two digits d1, d2 of h, and leaves the same remainder. So
+    // per rotation and digit pair p < k^2 the table holds both characters
+    // spread two bytes apart (hi's digits land on every other position), and
+    // what they add to the Luhn sum on even and on odd positions.
+    const unsigned pairs = k * k;
+    std::vector<uint32_t> pair_chars(10 * pairs);
+    std::vector<uint8_t> pair_even(10 * pairs), pair_odd(10 * pairs);
+    for (unsigned rotate = 0; rotate < 10; ++rotate)
+        for (unsigned p = 0; p < pairs; ++p) {
+            const uint8_t d1 = kRotated[rotate + p / k], d2 = kRotated[rotate + p % k];
+            pair_chars[rotate * pairs + p] = uint32_t('0' + d1) | uint32_t('0' + d2) << 16;
+            pair_even[rotate * pairs + p] = uint8_t(even[d1] + even[d2]);
+            pair_odd[rotate * pairs + p] = uint8_t(odd[d1] + odd[d2]);
+        }
+
+    for (uint64_t row = first; row < last; ++row) {
+        // Two draws per row. w0 is cut into fields:
+        //   bits 48-63 issuer, 32-47 prefix, 8-31 "repeat?", 0-7 alphabet rotation
+        // and w1 is spent entirely on body digits.
+        const uint64_t w0 = wyrand_at(seed, row * 2);
+        const uint64_t w1 = wyrand_at(seed, row * 2 + 1);
+
+        const Table &table = tables[((w0 >> 48) * issuers) >> 16];
+        const Prefix &prefix = table.prefixes[((w0 >> 32 & 0xFFFF) * table.size) >> 16];
+
+        char *line = out + (row - first) * (length + 1);
+        std::memcpy(line, prefix.digits, 4);
+        char *digit = line + 4;
+        uint32_t sum = prefix.luhn_sum;
+
+        // Body digits: the base-k expansions of the two halves of w1 (as fractions
+        // of 2^32), one multiply per digit. Two independent halves means two
+        // multiply chains the CPU can run side by side; 32 bits are plenty for
+        // the at most 7 digits each one yields. With k < 10 the digits are
+        // rotated onto k neighbouring digits ("345", "890"...). Each digit is
+        // written and added to the Luhn sum the moment it exists.
+        const unsigned rotate = unsigned(((w0 & 0xFF) * 10) >> 8);
+        const uint8_t *rotated = kRotated + rotate;
+        uint64_t hi = w1 >> 32, lo = uint32_t(w1);
+        size_t i = 0;
+        // Four digits per step (hi's at i and i + 2, lo's at i + 1 and i + 3), one store
+        const uint32_t *chars = pair_chars.data() + rotate * pairs;
+        const uint8_t *sum_even = pair_even.data() + rotate * pairs, *sum_odd = pair_odd.data() + rotate * pairs;
+        for (; i + 3 < body; i += 4) {
+            hi *= pairs;
+            lo *= pairs;
+            const uint32_t a = uint32_t(hi >> 32), b = uint32_t(lo >> 32);
+            const uint32_t quad = chars[a] | chars[b] << 8;
+            std::memcpy(digit + i, &quad, 4);
+            sum += sum_even[a] + sum_odd[b];
+            hi = uint32_t(hi);
+            lo = uint32_t(lo);
+        }
+        for (; i + 1 < body; i += 2) {
+            hi *= k;
+            lo *= k;
+            const uint8_t a = rotated[hi >> 32], b = rotated[lo >> 32];
+            sum += even[a] + odd[b];
+            digit[i] = char('0' + a);
+            digit[i + 1] = char('0' + b);
+            hi = uint32_t(hi);
+            lo = uint32_t(lo);
+        }
+        if (i < body) {
+            const uint8_t a = rotated[(hi * k) >> 32];
+            sum += even[a];
+            digit[i] = char('0' + a);
+        }
+
+        // Some rows get a block copied right after itself ("47" -> "4747"); the
+        // copy changes the digits, so those rows (only) redo the body's sum
+        if ((w0 >> 8 & 0xFFFFFF) < repeat_below && body >= 2) {
+            const size_t block = 1 + (w0 >> 8) % std::min<size_t>(3, body / 2);
+            const size_t at = (w0 >> 10) % (body - 2 * block + 1);
+            std::memcpy(digit + at + block, digit + at, block);
+            sum = prefix.luhn_sum;
+            for (size_t j = 0; j < body; ++j) sum += (j % 2 ? odd : even)[digit[j] - '0'];
+        }
+
+        line[length - 1] = char('0' + (10 - sum % 10) % 10); // The digit that makes the sum a multiple of 10
+        line[length] = '\n';
+    }
+}
+
+// pwrite() all of buf at `offset`, however many calls it takes
+bool write_all(int fd, const char *buf, size_t bytes, uint64_t offset) {
+    while (bytes > 0) {
+        const ssize_t n = ::pwrite(fd, buf, bytes, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        bytes -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+/* ---------------------
+   Public API
+---------------------- */
+
+bool parse_issuer_list(const std::string &text, std::vector<Issuer> &issuers) {
+    issuers.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        Issuer issuer = issuer_from_name(std::string_view(text).substr(start, comma - start));
+        if (issuer == Issuer::Unknown) return false;
+        issuers.push_back(issuer);
+        start = comma + 1;
+    }
+    return !issuers.empty();
+}
+
+bool generate_pans(const GeneratorOptions &options, const std::string &path) {
+    const size_t row_bytes = options.length + 1;
+    const uint64_t bytes = options.count * row_bytes;
+    // Sized up front, so every thread's pwrite()s land in place. (Not a regular
+    // file, e.g. /dev/null to time the generator alone: nothing to size.)
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    struct stat st{};
+    if (fd < 0 || ::fstat(fd, &st) != 0 || (S_ISREG(st.st_mode) && ::ftruncate(fd, static_cast<off_t>(bytes)) != 0)) {
+        std::cerr << "[ERROR] Could not create " << path << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    const std::vector<std::vector<Prefix>> prefixes = build_prefixes(options);
+
+    // Each thread gets one contiguous stretch of rows, stamped a tray at a
+    // time into its own 2 MiB mapping and written to the file from there.
+    // errno is per thread: the first failure's is kept for the message.
+    const uint64_t tray_rows = std::max<uint64_t>(1, kHugePageSize / row_bytes);
+    const size_t threads = std::max<size_t>(1, std::min<uint64_t>(options.threads, options.count));
+    std::atomic<int> error{0};
+    auto press = [&](uint64_t first, uint64_t last) {
+        PageMapping tray(kHugePageSize, -1);
+        if (!tray) {
+            error = errno ? errno : ENOMEM;
+            return;
+        }
+        prefault_pages(tray.data(), tray.size(), true, false);
+        for (uint64_t row = first; row < last && !error; row += tray_rows) {
+            const uint64_t rows = std::min(tray_rows, last - row);
+            generate_rows(options, prefixes, tray.data(), row, row + rows);
+            if (!write_all(fd, tray.data(), rows * row_bytes, row * row_bytes)) error = errno ? errno : EIO;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t)
+        pool.emplace_back(press, options.count * t / threads, options.count * (t + 1) / threads);
+    press(0, options.count / threads);
+    for (std::thread &thread : pool) thread.join();
+
+    if (::close(fd) != 0 && !error) error = errno;
+    if (error) std::cerr << "[ERROR] Could not write " << path << ": " << std::strerror(error) << "\n";
+    return !error;
+}
+
+int run_generate(const GeneratorOptions &options, const std::string &path) {
+    if (path.empty() || path == "-") {
+        std::cerr << "[ERROR] --generate needs --output FILE (rows are written in place at their offsets)\n";
+        return 1;
+    }
+    if (options.entropy_digits < 2 || options.entropy_digits > 10) {
+        std::cerr << "[ERROR] --entropy-digits must be between 2 and 10\n";
+        return 1;
+    }
+    if (!(options.repeat_fraction >= 0.0 && options.repeat_fraction <= 1.0)) {
+        std::cerr << "[ERROR] --repeat-fraction must be between 0 and 1\n";
+        return 1;
+    }
+    for (Issuer issuer : options.issuers) {
+        if (options.length < 6 || !issuer_rule(issuer).allows(options.length)) {
+            std::cerr << "[ERROR] " << issuer_name(issuer) << " numbers can't be " << options.length << " digits long\n";
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!generate_pans(options, path)) return 1;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "[RESULT] Generated " << options.count << " Luhn-valid " << options.length << "-digit numbers into "
+              << path << "\n";
+    std::cout << "[TIME] Generation completed in " << ns << " ns ("
+              << (options.count ? double(ns) / double(options.count) : 0.0) << " ns/number, "
+              << (ns ? double(options.count) * 1e3 / double(ns) : 0.0) << " M/s, " << options.threads
+              << " thread(s))\n";
+    return 0;
+}
@@ -0,0 +1,353 @@
+#include "http.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <mutex>
+
+/* ---------------------
+   Request Parser
+---------------------- */
+
+namespace {
+
+char lower(char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; }
+
+// Header names (and a few values) are case-insensitive
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (lower(a[i]) != lower(b[i])) return false;
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+const char *reason_phrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Error";
+    }
+}
+
+void append_number(std::string &out, uint64_t value) {
+    char digits[20];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+} // namespace
+
+HttpParse parse_http_request(std::string_view data, HttpRequest &req, int &status) {
+    req = HttpRequest{};
+    const size_t end = data.substr(0, kHttpMaxHeaderBytes).find("\r\n\r\n");
+    if (end == std::string_view::npos) {
+        if (data.size() < kHttpMaxHeaderBytes) return HttpParse::Incomplete;
+        status = 431;
+        return HttpParse::Error;
+    }
+    req.header_bytes = end + 4;
+    std::string_view head = data.substr(0, end);
+
+    // Request line: METHOD SP TARGET SP HTTP/1.x
+    size_t eol = head.find("\r\n");
+    std::string_view line = head.substr(0, eol);
+    head = eol == std::string_view::npos ? std::string_view{} : head.substr(eol + 2);
+    const size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1) {
+        status = 400;
+        return HttpParse::Error;
+    }
+    req.method = line.substr(0, sp1);
+    req.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    const std::string_view version = line.substr(sp2 + 1);
+    if (version == "HTTP/1.0") req.keep_alive = false;
+    else if (version != "HTTP/1.1") {
+        status = 505;
+        return HttpParse::Error;
+    }
+
+    // Headers: only the four that change how we read the request matter
+    bool have_length = false;
+    while (!head.empty()) {
+        eol = head.find("\r\n");
+        line = head.substr(0, eol);
+        head = eol == std::string_view::npos ? std::string_view{} : head.substr(eol + 2);
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0) {
+            status = 400;
+            return HttpParse::Error;
+        }
+        const std::string_view name = line.substr(0, colon), value = trim(line.substr(colon + 1));
+        if (iequals(name, "content-length")) {
+            size_t length = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (ec != std::errc() || ptr != value.data() + value.size() || (have_length && length != req.content_length)) {
+                status = 400; // Conflicting lengths are a request-smuggling classic
+                return HttpParse::Error;
+            }
+            req.content_length = length;
+            have_length = true;
+        } else if (iequals(name, "transfer-encoding")) {
+            status = 501; // No chunked bodies: every client we serve knows its body size
+            return HttpParse::Error;
+        } else if (iequals(name, "connection")) {
+            if (iequals(value, "close")) req.keep_alive = false;
+        } else if (iequals(name, "expect")) {
+            req.expect_continue = iequals(value, "100-continue");
+        }
+    }
+    if (req.content_length > kHttpMaxBodyBytes) {
+        status = 413;
+        return HttpParse::Error;
+    }
+    if (data.size() - req.header_bytes < req.content_length) return HttpParse::Incomplete;
+    req.body = data.substr(req.header_bytes, req.content_length);
+    return HttpParse::Complete;
+}
+
+/* ---------------------
+   JSON Batches
+---------------------- */
+
+long validate_json_array(std::string_view json, std::string &out) {
+    size_t i = 0;
+    auto skip_space = [&] {
+        while (i < json.size() && (json[i] == ' ' || json[i] == '\t' || json[i] == '\r' || json[i] == '\n')) ++i;
+    };
+
+    skip_space();
+    if (i == json.size() || json[i] != '[') return -1;
+    ++i;
+    out += '[';
+    long count = 0;
+    skip_space();
+    if (i < json.size() && json[i] == ']') {
+        out += ']';
+        ++i;
+        skip_space();
+        return i == json.size() ? 0 : -1;
+    }
+
+    for (;;) {
+        // One element: "digits" or bare digits. Card numbers never need escapes.
+        skip_space();
+        std::string_view card;
+        if (i < json.size() && json[i] == '"') {
+            const size_t close = json.find('"', i + 1);
+            if (close == std::string_view::npos) return -1;
+            card = json.substr(i + 1, close - i - 1);
+            if (card.find('\\') != std::string_view::npos) return -1;
+            i = close + 1;
+        } else {
+            const size_t start = i;
+            while (i < json.size() && json[i] >= '0' && json[i] <= '9') ++i;
+            if (i == start) return -1;
+            card = json.substr(start, i - start);
+        }
+
+        // Validated straight from the request bytes, answered in place
+        const CardResult res = validate_card_quiet(card);
+        if (count++) out += ',';
+        out += "{\"result\":\"";
+        out += result_label(res);
+        out += "\",\"issuer\":\"";
+        out += res.issuer.substr(0, 16);
+        out += "\",\"entropy\":";
+        char entropy[24];
+        out.append(entropy, std::to_chars(entropy, entropy + sizeof(entropy), res.entropy,
+                                          std::chars_format::fixed, 2).ptr);
+        out += '}';
+
+        skip_space();
+        if (i == json.size()) return -1;
+        if (json[i] == ',') {
+            ++i;
+            continue;
+        }
+        if (json[i] != ']') return -1;
+        ++i;
+        break;
+    }
+    out += ']';
+    skip_space();
+    return i == json.size() ? count : -1;
+}
+
+/* ---------------------
+   Connection
+---------------------- */
+
+namespace {
+
+// Buffers of idle connections, shared by all of them. Kept are at most
+// kPooledBuffers of each kind, none over kPooledBufferBytes, so one burst of
+// huge batches doesn't pin its memory forever.
+constexpr size_t kPooledBuffers = 64;
+constexpr size_t kPooledBufferBytes = 1 << 20;
+
+struct BufferPool {
+    std::mutex mutex;
+    std::vector<std::vector<char>> inputs;
+    std::vector<std::string> outputs;
+};
+BufferPool g_buffer_pool;
+
+void borrow(std::vector<char> &buf) {
+    std::lock_guard<std::mutex> lock(g_buffer_pool.mutex);
+    if (g_buffer_pool.inputs.empty()) return;
+    buf = std::move(g_buffer_pool.inputs.back());
+    g_buffer_pool.inputs.pop_back();
+}
+
+void borrow(std::string &buf) {
+    std::lock_guard<std::mutex> lock(g_buffer_pool.mutex);
+    if (g_buffer_pool.outputs.empty()) return;
+    buf = std::move(g_buffer_pool.outputs.back());
+    g_buffer_pool.outputs.pop_back();
+    buf.clear();
+}
+
+void give_back(std::vector<char> &buf) {
+    if (buf.empty()) return;
+    std::lock_guard<std::mutex> lock(g_buffer_pool.mutex);
+    if (g_buffer_pool.inputs.size() < kPooledBuffers && buf.size() <= kPooledBufferBytes)
+        g_buffer_pool.inputs.push_back(std::move(buf));
+    buf = std::vector<char>(); // Moved-from or not kept: either way, empty and unallocated
+}
+
+void give_back(std::string &buf) {
+    if (buf.capacity() <= std::string().capacity()) return; // Nothing on the heap
+    std::lock_guard<std::mutex> lock(g_buffer_pool.mutex);
+    if (g_buffer_pool.outputs.size() < kPooledBuffers && buf.capacity() <= kPooledBufferBytes)
+        g_buffer_pool.outputs.push_back(std::move(buf));
+    buf = std::string();
+}
+
+} // namespace
+
+std::span<char> HttpConnection::read_space() {
+    // Start at one header's worth; double when full. The parser rejects anything
+    // past the limits, so a single request never needs more than their sum.
+    if (in_.empty()) borrow(in_);
+    if (in_.empty()) in_.resize(kHttpMaxHeaderBytes);
+    if (in_used_ == in_.size()) in_.resize(std::min(in_.size() * 2, kHttpMaxHeaderBytes + kHttpMaxBodyBytes));
+    return std::span<char>(in_.data() + in_used_, in_.size() - in_used_);
+}
+
+bool HttpConnection::process() {
+    if (out_.capacity() <= std::string().capacity()) borrow(out_);
+    if (body_.capacity() <= std::string().capacity()) borrow(body_);
+    size_t pos = 0;
+    while (!closing_) {
+        HttpRequest req;
+        int status = 0;
+        const HttpParse parsed = parse_http_request(std::string_view(in_.data() + pos, in_used_ - pos), req, status);
+        if (parsed == HttpParse::Error) {
+            closing_ = true; // We can't tell where the next request would start
+            answer_error(status);
+            break;
+        }
+        if (parsed == HttpParse::Incomplete) {
+            // A client that asked first is waiting for our go-ahead before sending the body
+            if (req.header_bytes && req.expect_continue && !continue_sent_) {
+                out_ += "HTTP/1.1 100 Continue\r\n\r\n";
+                continue_sent_ = true;
+            }
+            break;
+        }
+        continue_sent_ = false;
+        closing_ = !req.keep_alive;
+        answer(req);
+        pos += req.header_bytes + req.content_length;
+    }
+
+    // Keep only the start of the next, unfinished request
+    if (closing_) pos = in_used_;
+    if (pos) {
+        std::memmove(in_.data(), in_.data() + pos, in_used_ - pos);
+        in_used_ -= pos;
+    }
+    return !closing_;
+}
+
+bool HttpConnection::large_request_ready(size_t bytes) const {
+    HttpRequest req;
+    int status = 0;
+    return parse_http_request(std::string_view(in_.data(), in_used_), req, status) == HttpParse::Complete &&
+           req.content_length >= bytes;
+}
+
+void HttpConnection::release_idle_buffers() {
+    if (in_used_ != 0 || out_sent_ != out_.size()) return;
+    give_back(in_);
+    give_back(out_);
+    give_back(body_);
+    out_sent_ = 0;
+}
+
+void HttpConnection::consume_output(size_t n) {
+    out_sent_ += n;
+    if (out_sent_ == out_.size()) {
+        out_.clear(); // Keeps its capacity for the next response
+        out_sent_ = 0;
+    }
+}
+
+void HttpConnection::answer(const HttpRequest &req) {
+    ++requests_;
+    if (req.target != "/validate") return answer_error(404);
+    if (req.method != "POST") return answer_error(405);
+
+    body_.clear();
+    const long count = validate_json_array(req.body, body_);
+    if (count < 0) return answer_error(400);
+    cards_ += static_cast<uint64_t>(count);
+
+    out_ += "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: ";
+    append_number(out_, body_.size());
+    out_ += closing_ ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n";
+    out_ += body_;
+}
+
+void HttpConnection::answer_error(int status) {
+    body_ = "{\"error\":\"";
+    body_ += reason_phrase(status);
+    body_ += "\"}";
+
+    out_ += "HTTP/1.1 ";
+    append_number(out_, static_cast<uint64_t>(status));
+    out_ += ' ';
+    out_ += reason_phrase(status);
+    out_ += "\r\nContent-Type: application/json\r\n";
+    if (status == 405) out_ += "Allow: POST\r\n";
+    out_ += "Content-Length: ";
+    append_number(out_, body_.size());
+    out_ += closing_ ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n";
+    out_ += body_;
+}
+
+/* ---------------------
+   Addresses
+---------------------- */
+
+bool parse_listen_address(const std::string &text, std::string &host, uint16_t &port) {
+    const size_t colon = text.rfind(':');
+    host = colon == std::string::npos ? "127.0.0.1" : text.substr(0, colon);
+    if (host.empty()) host = "127.0.0.1";
+    const std::string digits = colon == std::string::npos ? text : text.substr(colon + 1);
+    unsigned value = 0;
+    auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (ec != std::errc() || ptr != digits.data() + digits.size() || value == 0 || value > 65535) return false;
+    port = static_cast<uint16_t>(value);
+    return true;
+}
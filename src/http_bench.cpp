@@ -0,0 +1,153 @@
+#include "http.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* ---------------------
+   Load Generator
+---------------------- */
+
+namespace {
+
+constexpr size_t kBenchConnections = 4;
+
+// A mix of schemes and verdicts, so the server does realistic work
+constexpr std::string_view kBenchCards[] = {
+    "4539148803436467", "5555555555554444", "378282246310005",  "6011111111111117",
+    "4111111111111112", "3530111333300000", "4000056655665556", "1234567890123456",
+};
+
+// Reads one response at a time off a keep-alive connection; bytes of the
+// next (pipelined) response stay in the buffer for the next call
+struct ResponseReader {
+    std::vector<char> buf = std::vector<char>(1 << 20);
+    size_t used = 0;
+
+    bool read(int fd) {
+        for (;;) {
+            const std::string_view data(buf.data(), used);
+            const size_t end = data.find("\r\n\r\n");
+            if (end != std::string_view::npos) {
+                const std::string_view head = data.substr(0, end);
+                const size_t at = head.find("Content-Length: ");
+                if (head.substr(0, 12) != "HTTP/1.1 200" || at == std::string_view::npos) return false;
+                const size_t length = std::strtoul(head.data() + at + 16, nullptr, 10);
+                const size_t total = end + 4 + length;
+                if (total > buf.size()) buf.resize(total);
+                if (used >= total) {
+                    std::memmove(buf.data(), buf.data() + total, used - total);
+                    used -= total;
+                    return true;
+                }
+            }
+            if (used == buf.size()) buf.resize(buf.size() * 2);
+            const ssize_t got = ::recv(fd, buf.data() + used, buf.size() - used, 0);
+            if (got <= 0) return false;
+            used += static_cast<size_t>(got);
+        }
+    }
+};
+
+int connect_to(const sockaddr_in &addr) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+std::string build_request(size_t batch) {
+    std::string body = "[";
+    for (size_t i = 0; i < batch; ++i) {
+        if (i) body += ',';
+        body += '"';
+        body += kBenchCards[i % std::size(kBenchCards)];
+        body += '"';
+    }
+    body += ']';
+    return "POST /validate HTTP/1.1\r\nHost: bench\r\nContent-Type: application/json\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// `depth` requests go out back to back in one send(), then `depth` answers
+// are read: one "round". Latency is per round.
+bool run_client(const sockaddr_in &addr, const std::string &round_bytes, size_t depth, size_t rounds,
+                std::vector<uint64_t> &ns) {
+    const int fd = connect_to(addr);
+    if (fd < 0) return false;
+    ResponseReader reader;
+    bool ok = true;
+    for (size_t r = 0; r < rounds && ok; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        ok = ::send(fd, round_bytes.data(), round_bytes.size(), MSG_NOSIGNAL) == ssize_t(round_bytes.size());
+        for (size_t i = 0; i < depth && ok; ++i) ok = reader.read(fd);
+        auto t1 = std::chrono::steady_clock::now();
+        ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+int run_http_benchmark(const std::string &target) {
+    std::string host;
+    uint16_t port = 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    if (!parse_listen_address(target, host, port) || ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "[ERROR] --http-bench needs [IPV4:]PORT, got '" << target << "'\n";
+        return 2;
+    }
+    addr.sin_port = htons(port);
+
+    struct Scenario {
+        size_t batch, depth, requests;
+    };
+    const Scenario scenarios[] = {{1, 1, 40000}, {1, 16, 160000}, {64, 1, 8000}, {4096, 1, 400}};
+
+    for (const Scenario &s : scenarios) {
+        std::string round_bytes;
+        const std::string request = build_request(s.batch);
+        for (size_t i = 0; i < s.depth; ++i) round_bytes += request;
+        const size_t rounds = s.requests / s.depth / kBenchConnections;
+
+        // Closed loop: each connection waits for its answers before sending again
+        std::vector<std::vector<uint64_t>> ns(kBenchConnections);
+        std::vector<char> ok(kBenchConnections, 0);
+        std::vector<std::thread> clients;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < kBenchConnections; ++c) {
+            ns[c].reserve(rounds);
+            clients.emplace_back([&, c] { ok[c] = run_client(addr, round_bytes, s.depth, rounds, ns[c]); });
+        }
+        for (std::thread &t : clients) t.join();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (std::count(ok.begin(), ok.end(), 0)) {
+            std::cerr << "[ERROR] Could not talk to an HTTP server on " << host << ":" << port << "\n";
+            return 1;
+        }
+
+        std::vector<uint64_t> all;
+        for (const auto &v : ns) all.insert(all.end(), v.begin(), v.end());
+        std::sort(all.begin(), all.end());
+        const double requests = double(rounds * s.depth * kBenchConnections);
+        std::cout << "[BENCH] http batch " << s.batch;
+        if (s.depth > 1) std::cout << " (pipelined x" << s.depth << ")";
+        std::cout << ": " << uint64_t(requests / seconds) << " req/s, " << uint64_t(requests * s.batch / seconds)
+                  << " cards/s, p50 " << all[all.size() / 2] / 1000 << " us, p99 " << all[all.size() * 99 / 100] / 1000
+                  << " us" << (s.depth > 1 ? " per round" : "") << " (" << kBenchConnections << " connections)\n";
+    }
+    return 0;
+}
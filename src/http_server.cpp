@@ -0,0 +1,187 @@
+#include "http.h"
+#include "event_loop.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/* ---------------------
+   HTTP Server
+---------------------- */
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void handle_stop_signal(int) { g_stop.store(true, std::memory_order_relaxed); }
+
+// Reads in a row before a busy connection lets the others have the loop
+constexpr int kReadsPerTurn = 16;
+
+// How long accepting stops when the process is out of descriptors
+constexpr long kAcceptPauseMs = 100;
+
+struct ServerStats {
+    std::atomic<uint64_t> connections{0}, requests{0}, cards{0}, offloaded{0};
+    size_t peak_connections = 0; // Loop thread only
+    size_t live_connections = 0;
+};
+
+// One client, start to finish. Every co_await is a point where the loop
+// thread goes off to serve someone else; while this connection is idle all
+// that's left of it is this frame (its buffers went back to the pool).
+DetachedTask serve_connection(EventLoop &loop, ComputePool &pool, int fd, ServerStats &stats) {
+    AsyncSocket sock(loop, fd);
+    HttpConnection conn;
+    stats.peak_connections = std::max(stats.peak_connections, ++stats.live_connections);
+
+    bool open = sock.ok();
+    int reads = 0;
+    uint64_t counted_requests = 0, counted_cards = 0;
+    while (open) {
+        const std::span<char> space = conn.read_space();
+        const ssize_t got = ::recv(fd, space.data(), space.size(), 0);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            conn.release_idle_buffers();
+            co_await sock.readable();
+            reads = 0;
+            continue;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        conn.received(static_cast<size_t>(got));
+
+        // A big batch would hold up every other connection on this loop:
+        // validate it on a compute thread and come back for the reply
+        if (conn.large_request_ready(kHttpOffloadBytes)) {
+            stats.offloaded.fetch_add(1, std::memory_order_relaxed);
+            co_await pool.schedule();
+            open = conn.process();
+            co_await loop.schedule();
+        } else {
+            open = conn.process();
+        }
+
+        for (std::string_view out = conn.pending_output(); !out.empty(); out = conn.pending_output()) {
+            const ssize_t sent = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                co_await sock.writable();
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) {
+                open = false;
+                break;
+            }
+            conn.consume_output(static_cast<size_t>(sent));
+        }
+
+        // Counted as we go: a connection still open at shutdown is never resumed
+        stats.requests.fetch_add(conn.requests() - counted_requests, std::memory_order_relaxed);
+        stats.cards.fetch_add(conn.cards() - counted_cards, std::memory_order_relaxed);
+        counted_requests = conn.requests();
+        counted_cards = conn.cards();
+
+        // A client that never stops pipelining mustn't starve the rest
+        if (++reads == kReadsPerTurn) {
+            reads = 0;
+            co_await loop.schedule();
+        }
+    }
+
+    --stats.live_connections;
+}
+
+DetachedTask accept_connections(EventLoop &loop, ComputePool &pool, int listener, ServerStats &stats) {
+    AsyncSocket sock(loop, listener);
+    if (!sock.ok()) co_return;
+    // Out of descriptors or memory the listener stays readable, so accepting
+    // again at once would spin; instead we step back for kAcceptPauseMs and
+    // let the open connections (and the stop flag) have the loop
+    AsyncSocket pause(loop, ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+    const itimerspec pause_for{{0, 0}, {0, kAcceptPauseMs * 1000000L}};
+    const int on = 1;
+    for (;;) {
+        const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await sock.readable();
+            } else if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                if (pause.ok() && ::timerfd_settime(pause.fd(), 0, &pause_for, nullptr) == 0) {
+                    co_await pause.readable();
+                    uint64_t expirations;
+                    [[maybe_unused]] ssize_t n = ::read(pause.fd(), &expirations, sizeof(expirations));
+                } else {
+                    co_await loop.schedule();
+                }
+            }
+            continue; // EINTR, or a client that hung up before we got to it
+        }
+        // Responses are written whole, so Nagle's delay would only add latency
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        stats.connections.fetch_add(1, std::memory_order_relaxed);
+        serve_connection(loop, pool, fd, stats); // Runs until its first co_await, then comes back here
+    }
+}
+
+} // namespace
+
+int run_http_server(const std::string &listen, size_t threads) {
+    std::string host;
+    uint16_t port = 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    if (!parse_listen_address(listen, host, port) || ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "[ERROR] --http-serve needs [IPV4:]PORT, got '" << listen << "'\n";
+        return 2;
+    }
+    addr.sin_port = htons(port);
+
+    const int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int on = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "[ERROR] Could not listen on " << host << ":" << port << ": " << std::strerror(errno) << "\n";
+        if (listener >= 0) ::close(listener);
+        return 1;
+    }
+
+    EventLoop loop;
+    if (!loop.ok()) {
+        std::cerr << "[ERROR] Could not create an epoll instance: " << std::strerror(errno) << "\n";
+        ::close(listener);
+        return 1;
+    }
+    ComputePool pool(threads ? threads : 1);
+    ServerStats stats;
+
+    g_stop.store(false);
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+    std::cout << "[INFO] HTTP server listening on " << host << ":" << port << " (POST /validate), "
+              << pool.size() << " compute thread(s)" << std::endl;
+
+    accept_connections(loop, pool, listener, stats); // Owns `listener` from here on
+    loop.run(g_stop);
+
+    // Let in-flight batches finish (they post themselves back to the loop),
+    // then free every coroutine that is still waiting
+    pool.stop();
+    loop.close_all();
+
+    std::cout << "[INFO] HTTP server closing after " << stats.requests.load() << " requests ("
+              << stats.cards.load() << " cards, " << stats.offloaded.load() << " large batches on compute threads) on "
+              << stats.connections.load() << " connections\n";
+    std::cout << "[INFO] Peak " << stats.peak_connections << " open connections; an idle one is a "
+              << coroutine_frame_bytes_max() << "-byte coroutine frame\n";
+    return 0;
+}
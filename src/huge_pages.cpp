@@ -0,0 +1,136 @@
+#include "huge_pages.h"
+#include "numa_topology.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+/* ---------------------
+   Settings
+---------------------- */
+
+namespace {
+
+MemoryOptions g_options;
+std::atomic<uint64_t> g_hugetlb_fallbacks{0};
+
+#ifndef MAP_HUGE_2MB
+constexpr int MAP_HUGE_2MB = 21 << 26; // log2(2 MiB) << MAP_HUGE_SHIFT
+#endif
+
+} // namespace
+
+void set_memory_options(const MemoryOptions &options) { g_options = options; }
+const MemoryOptions &memory_options() { return g_options; }
+
+/* ---------------------
+   Mappings
+---------------------- */
+
+void *map_pages(size_t bytes, int node) {
+    if (bytes == 0) return nullptr;
+    const bool huge = g_options.huge_pages != HugePages::Off && bytes % kHugePageSize == 0;
+    void *memory = MAP_FAILED;
+
+    if (huge && g_options.huge_pages == HugePages::Explicit) {
+        memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (memory == MAP_FAILED) g_hugetlb_fallbacks.fetch_add(1, std::memory_order_relaxed); // Pool empty
+    }
+    if (memory == MAP_FAILED && huge) {
+        // THP only puts a huge page where a whole aligned 2 MiB stretch is
+        // mapped: map one huge page too many and trim both ends to the boundary
+        void *raw = ::mmap(nullptr, bytes + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED) {
+            const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            const uintptr_t aligned = round_to_pages(start, kHugePageSize);
+            if (aligned > start) ::munmap(raw, aligned - start);
+            if (start + kHugePageSize > aligned)
+                ::munmap(reinterpret_cast<void *>(aligned + bytes), start + kHugePageSize - aligned);
+            memory = reinterpret_cast<void *>(aligned);
+            ::madvise(memory, bytes, MADV_HUGEPAGE);
+        }
+    }
+    if (memory == MAP_FAILED && !huge)
+        memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+
+    bind_to_node(memory, bytes, node);
+    return memory;
+}
+
+void unmap_pages(void *memory, size_t bytes) {
+    if (memory) ::munmap(memory, bytes);
+}
+
+void advise_huge_mapping(void *memory, size_t bytes) {
+    if (memory && g_options.huge_pages != HugePages::Off) ::madvise(memory, bytes, MADV_HUGEPAGE);
+}
+
+bool prefault_pages(void *memory, size_t bytes, bool write, bool lock) {
+    if (!memory || bytes == 0) return true;
+    // madvise and mlock want whole pages
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(memory) / kSmallPageSize * kSmallPageSize;
+    const uintptr_t end = round_to_pages(reinterpret_cast<uintptr_t>(memory) + bytes, kSmallPageSize);
+    char *const first = reinterpret_cast<char *>(begin);
+    const size_t length = end - begin;
+
+    // One call where the kernel has it (5.14+), else one touch per page
+    bool populated = false;
+#if defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+    populated = ::madvise(first, length, write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0;
+#endif
+    if (!populated) {
+        volatile char *p = static_cast<char *>(memory);
+        for (size_t off = 0; off < bytes; off += kSmallPageSize) {
+            if (write) p[off] = p[off];
+            else (void)p[off];
+        }
+    }
+    return !lock || ::mlock(first, length) == 0;
+}
+
+/* ---------------------
+   Lookup Tables
+---------------------- */
+
+void *allocate_table(size_t bytes) {
+    if (bytes < kLargeTableBytes) return ::operator new(bytes);
+    void *memory = map_pages(round_to_pages(bytes, kHugePageSize));
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void free_table(void *memory, size_t bytes) {
+    if (bytes < kLargeTableBytes) ::operator delete(memory);
+    else unmap_pages(memory, round_to_pages(bytes, kHugePageSize));
+}
+
+/* ---------------------
+   Reporting
+---------------------- */
+
+size_t huge_page_bytes() {
+    // Anonymous THP, THP in shared memory and the page cache, and hugetlb pages
+    static const char *const kFields[] = {"AnonHugePages:", "ShmemPmdMapped:", "FilePmdMapped:",
+                                          "Shared_Hugetlb:", "Private_Hugetlb:"};
+    std::ifstream file("/proc/self/smaps_rollup");
+    std::string line;
+    size_t kib = 0;
+    while (std::getline(file, line)) {
+        for (const char *field : kFields)
+            if (line.compare(0, std::strlen(field), field) == 0) kib += std::stoull(line.substr(std::strlen(field)));
+    }
+    return kib * 1024;
+}
+
+uint64_t hugetlb_fallbacks() { return g_hugetlb_fallbacks.load(std::memory_order_relaxed); }
+
+uint64_t page_faults() {
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+}
@@ -0,0 +1,355 @@
+#include "ingest.h"
+#include "pipeline.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ---------------------
+   64-Byte Bitmask Scanning
+---------------------- */
+
+namespace {
+
+/*
+ * One 64-byte block of input. eq(c) answers "which of these 64 bytes are c?"
+ * as a 64-bit mask (bit i = byte i): four 16-byte SSE2 compares and a
+ * movemask each. Past the end of the input the block is padded with spaces,
+ * which match nothing we ever look for.
+ */
+class Block {
+public:
+    Block(const char *p, size_t avail) {
+        char padded[64];
+        if (avail < 64) {
+            std::memset(padded, ' ', sizeof(padded));
+            std::memcpy(padded, p, avail);
+            p = padded;
+        }
+#if defined(__SSE2__)
+        for (int i = 0; i < 4; ++i) v_[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+#else
+        std::memcpy(bytes_, p, 64);
+#endif
+    }
+
+    uint64_t eq(char c) const {
+#if defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(c);
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            auto bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v_[i], needle)));
+            mask |= uint64_t(bits) << (16 * i);
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; ++i) mask |= uint64_t(bytes_[i] == c) << i;
+        return mask;
+#endif
+    }
+
+private:
+#if defined(__SSE2__)
+    __m128i v_[4];
+#else
+    char bytes_[64];
+#endif
+};
+
+// Bit i of the result = XOR of bits 0..i: a quote opens a region, the next one
+// closes it, so this marks every byte from an opening quote up to (not
+// including) its closing quote.
+inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Bits of the characters escaped by a backslash (simdjson's branchless
+// version): in \\" the quote is real, in \" it is not. prev_escaped carries
+// an odd run of backslashes over into the next block.
+inline uint64_t find_escaped(uint64_t backslash, uint64_t &prev_escaped) {
+    backslash &= ~prev_escaped;
+    const uint64_t follows_escape = backslash << 1 | prev_escaped;
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits;
+    prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits);
+    const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// All bits up to and including `bit`
+inline uint64_t mask_through(unsigned bit) {
+    return (uint64_t(2) << bit) - 1;
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Strip one pair of surrounding double quotes, if present
+inline std::string_view unquote(std::string_view field) {
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"') return field.substr(1, field.size() - 2);
+    return field;
+}
+
+void add_record(RecordBatch &batch, std::string_view pan, uint64_t line, std::string_view head = {},
+                std::string_view tail = {}) {
+    if (batch.records.size() <= batch.count) {
+        batch.records.emplace_back();
+        batch.line_numbers.emplace_back();
+        batch.heads.emplace_back();
+        batch.tails.emplace_back();
+    }
+    batch.records[batch.count] = pan;
+    batch.line_numbers[batch.count] = line;
+    batch.heads[batch.count] = head;
+    batch.tails[batch.count] = tail;
+    batch.count++;
+}
+
+/* ---------------------
+   JSON Member Lookup
+---------------------- */
+
+struct JsonMember {
+    size_t start = 0;       // Opening quote of the key
+    size_t value_start = 0; // First byte of the value
+    size_t value_end = 0;   // One past its last byte (whitespace trimmed)
+};
+
+/*
+ * Find `key` among the top-level members of the JSON object in `line`.
+ * Only structural characters outside strings ({ } [ ] : ,) and real quotes
+ * are visited; everything else is skipped 64 bytes at a time. Keys are
+ * compared raw (escapes are not decoded), which is all a field name needs.
+ */
+bool find_json_member(std::string_view line, std::string_view key, JsonMember &member) {
+    size_t first = 0;
+    while (first < line.size() && is_space(line[first])) ++first;
+    if (first == line.size() || line[first] != '{') return false;
+
+    const size_t npos = std::string_view::npos;
+    int depth = 0;
+    bool expect_key = false, matched = false;
+    size_t key_start = npos, value_start = npos;
+    uint64_t in_string = 0, prev_escaped = 0;
+
+    for (size_t base = 0; base < line.size(); base += 64) {
+        const Block block(line.data() + base, line.size() - base);
+        const uint64_t escaped = find_escaped(block.eq('\\'), prev_escaped);
+        const uint64_t quote = block.eq('"') & ~escaped;
+        const uint64_t inside = prefix_xor(quote) ^ in_string;
+        in_string = uint64_t(int64_t(inside) >> 63);
+        const uint64_t structural = block.eq('{') | block.eq('}') | block.eq('[') | block.eq(']') |
+                                    block.eq(':') | block.eq(',');
+        uint64_t events = (structural & ~inside) | quote;
+
+        while (events) {
+            const unsigned bit = static_cast<unsigned>(__builtin_ctzll(events));
+            events &= events - 1;
+            const size_t pos = base + bit;
+            switch (line[pos]) {
+            case '"':
+                if (inside >> bit & 1) { // Opening quote
+                    if (depth == 1 && expect_key) {
+                        key_start = pos + 1;
+                        member.start = pos;
+                        expect_key = false;
+                    }
+                } else if (key_start != npos) { // Closing quote of a key
+                    matched = line.substr(key_start, pos - key_start) == key;
+                    key_start = npos;
+                }
+                break;
+            case ':':
+                if (depth == 1 && matched && value_start == npos) {
+                    value_start = pos + 1;
+                    while (value_start < line.size() && is_space(line[value_start])) ++value_start;
+                }
+                break;
+            case '{':
+            case '[':
+                if (++depth == 1) expect_key = true;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    if (value_start == npos) return false;
+                    member.value_start = value_start;
+                    member.value_end = pos;
+                    while (member.value_end > value_start && is_space(line[member.value_end - 1])) --member.value_end;
+                    return true;
+                }
+                break;
+            case ',':
+                if (depth != 1) break;
+                if (value_start != npos) {
+                    member.value_start = value_start;
+                    member.value_end = pos;
+                    while (member.value_end > value_start && is_space(line[member.value_end - 1])) --member.value_end;
+                    return true;
+                }
+                expect_key = true;
+                break;
+            }
+        }
+    }
+    return false; // Truncated object
+}
+
+} // namespace
+
+/* ---------------------
+   Record Splitter
+---------------------- */
+
+size_t RecordSplitter::split(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number) {
+    switch (spec_.format) {
+    case InputFormat::Csv: return split_csv(buf, len, last, batch, line_number);
+    case InputFormat::Jsonl: return split_jsonl(buf, len, last, batch, line_number);
+    default: return split_lines(buf, len, last, batch, line_number);
+    }
+}
+
+// Plain mode: one PAN per line, exactly as before. memchr is libc's SIMD newline search.
+size_t RecordSplitter::split_lines(const char *buf, size_t len, bool last, RecordBatch &batch,
+                                   uint64_t &line_number) {
+    size_t begin = 0;
+    while (begin < len) {
+        const void *newline = std::memchr(buf + begin, '\n', len - begin);
+        if (!newline && !last) break;
+        const size_t end = newline ? static_cast<size_t>(static_cast<const char *>(newline) - buf) : len;
+        ++line_number;
+        if (end > begin) add_record(batch, std::string_view(buf + begin, end - begin), line_number);
+        begin = end + 1;
+    }
+    return begin < len ? begin : len;
+}
+
+size_t RecordSplitter::split_jsonl(const char *buf, size_t len, bool last, RecordBatch &batch,
+                                   uint64_t &line_number) {
+    size_t begin = 0;
+    while (begin < len) {
+        const void *newline = std::memchr(buf + begin, '\n', len - begin);
+        if (!newline && !last) break;
+        size_t end = newline ? static_cast<size_t>(static_cast<const char *>(newline) - buf) : len;
+        ++line_number;
+        const size_t next = end + 1;
+        if (end > begin && buf[end - 1] == '\r') --end;
+
+        std::string_view line(buf + begin, end - begin);
+        if (!line.empty()) {
+            JsonMember m;
+            if (find_json_member(line, spec_.field, m)) {
+                add_record(batch, unquote(line.substr(m.value_start, m.value_end - m.value_start)), line_number,
+                           line.substr(0, m.start), line.substr(m.value_end));
+            } else {
+                ++missing_;
+                add_record(batch, {}, line_number, "{", "}"); // Still one valid JSON object per line
+            }
+        }
+        begin = next;
+    }
+    return begin < len ? begin : len;
+}
+
+/*
+ * CSV: the whole chunk is scanned block by block. Commas and newlines count
+ * only outside quotes, and a doubled quote ("") inside a quoted field simply
+ * toggles the quote state twice, so it needs no special case. Each record
+ * starts outside quotes, so a chunk always starts from a clean state.
+ */
+size_t RecordSplitter::split_csv(const char *buf, size_t len, bool last, RecordBatch &batch, uint64_t &line_number) {
+    const size_t npos = std::string_view::npos;
+    size_t record_start = 0, field_start = 0, field = 0;
+    size_t pan_start = npos, pan_end = npos;
+    const uint64_t lines_at_start = line_number;
+    uint64_t lines_before_block = 0; // Newlines in buf before the current block
+    uint64_t record_line = line_number + 1;
+    uint64_t in_quotes = 0;
+
+    // The field just ended at `end`: is it the PAN column?
+    auto take_field = [&](size_t end) {
+        if (header_done_) {
+            if (field == column_) pan_start = field_start, pan_end = end;
+        } else if (pan_start == npos && unquote(std::string_view(buf + field_start, end - field_start)) == spec_.field) {
+            column_ = field;
+            pan_start = field_start, pan_end = end;
+        }
+        ++field;
+        field_start = end + 1;
+    };
+
+    // The record [record_start, end) is complete
+    auto take_record = [&](size_t end) {
+        if (end > record_start && buf[end - 1] == '\r') --end;
+        if (end > record_start) {
+            take_field(end);
+            const std::string_view head(buf + record_start, pan_start == npos ? 0 : pan_start - record_start);
+            const std::string_view tail = pan_end == npos ? std::string_view() : std::string_view(buf + pan_end, end - pan_end);
+            if (!header_done_) {
+                if (pan_start == npos) {
+                    error_ = "Column \"" + spec_.field + "\" not found in the CSV header";
+                    return;
+                }
+                header_done_ = true;
+                if (spec_.passthrough) {
+                    header_ = "line," + std::string(head) + "result,issuer,entropy" + std::string(tail) + "\n";
+                    // Empty fields in place of the ones before and after the PAN column
+                    tail_fields_ = field - column_ - 1;
+                    empty_fields_.assign(std::max(column_, tail_fields_), ',');
+                }
+            } else if (pan_start == npos) {
+                // No PAN column in this row: keep the header's column count with empty fields
+                ++missing_;
+                const std::string_view empty(empty_fields_);
+                add_record(batch, {}, record_line, empty.substr(0, column_), empty.substr(0, tail_fields_));
+            } else {
+                add_record(batch, unquote(std::string_view(buf + pan_start, pan_end - pan_start)), record_line, head,
+                           tail);
+            }
+        }
+        field = 0;
+        pan_start = pan_end = npos;
+    };
+
+    for (size_t base = 0; base < len && !failed(); base += 64) {
+        const Block block(buf + base, len - base);
+        const uint64_t newline = block.eq('\n');
+        const uint64_t inside = prefix_xor(block.eq('"')) ^ in_quotes;
+        in_quotes = uint64_t(int64_t(inside) >> 63);
+        uint64_t events = (block.eq(',') | newline) & ~inside;
+
+        while (events && !failed()) {
+            const unsigned bit = static_cast<unsigned>(__builtin_ctzll(events));
+            events &= events - 1;
+            const size_t pos = base + bit;
+            if (buf[pos] == ',') {
+                take_field(pos);
+                continue;
+            }
+            take_record(pos);
+            // Newlines inside quoted fields still count as input lines
+            line_number = lines_at_start + lines_before_block +
+                          static_cast<uint64_t>(__builtin_popcountll(newline & mask_through(bit)));
+            record_line = line_number + 1;
+            record_start = field_start = pos + 1;
+        }
+        lines_before_block += static_cast<uint64_t>(__builtin_popcountll(newline));
+    }
+    if (failed()) return len;
+    if (last && record_start < len) {
+        take_record(len);
+        line_number = lines_at_start + lines_before_block + 1;
+        return len;
+    }
+    return record_start;
+}
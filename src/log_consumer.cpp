@@ -0,0 +1,163 @@
+#include "segment_log.h"
+#include "validator.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* ---------------------
+   Test Producer
+---------------------- */
+
+int run_log_append(const std::string &input, const std::string &log, uint32_t partitions, uint64_t segment_bytes) {
+    if (partitions == 0) partitions = std::max<uint32_t>(count_partitions(log), 1);
+    std::ifstream file(input, std::ios::binary);
+    if (!file) {
+        std::cerr << "[ERROR] Could not open " << input << "\n";
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<PartitionWriter>> writers;
+    for (uint32_t p = 0; p < partitions; ++p) {
+        writers.push_back(std::make_unique<PartitionWriter>());
+        if (!writers.back()->open(partition_dir(log, p), PartitionWriter::kNoTruncate, segment_bytes)) return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t records = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!writers[records++ % partitions]->append(line)) return 1;
+    }
+    for (auto &writer : writers)
+        if (!writer->flush()) return 1;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
+                  .count();
+
+    std::cout << "[RESULT] Appended " << records << " records to " << log << " (" << partitions << " partitions)\n";
+    std::cout << "[TIME] Append completed in " << ns << " ns\n";
+    return 0;
+}
+
+/* ---------------------
+   Consumer
+---------------------- */
+
+namespace {
+
+constexpr size_t kLogBatch = 4096;     // Records validated per batch
+constexpr size_t kCommitBatches = 16;  // Batches per offset commit
+
+// What every partition thread shares: the committed offsets and the totals
+struct ConsumerGroup {
+    std::string offsets_path;
+    std::mutex mutex;
+    std::vector<CommittedOffset> committed;
+    uint64_t commits = 0;
+    std::atomic<uint64_t> total{0}, valid{0}, low_confidence{0};
+    std::atomic<bool> failed{false};
+
+    bool commit(uint32_t partition, CommittedOffset position) {
+        std::lock_guard<std::mutex> lock(mutex);
+        committed[partition] = position;
+        ++commits;
+        return save_offsets(offsets_path, committed);
+    }
+};
+
+// One output record: "<input offset>,<result>,<issuer>,<entropy>", the batch output line format
+constexpr size_t kMaxResultRecord = 20 + 1 + 20 + 1 + 16 + 1 + 24;
+
+bool consume_partition(const std::string &log, const std::string &out, uint32_t partition, ConsumerGroup &group) {
+    CommittedOffset position;
+    {
+        std::lock_guard<std::mutex> lock(group.mutex);
+        position = group.committed[partition];
+    }
+
+    // Output first: cut back anything written after the last commit
+    PartitionWriter writer;
+    PartitionReader reader;
+    if (!writer.open(partition_dir(out, partition), position.output)) return false;
+    if (!reader.open(partition_dir(log, partition), position.input)) return false;
+
+    std::vector<LogRecord> records(kLogBatch);
+    uint64_t total = 0, valid = 0, low_confidence = 0;
+    size_t batches = 0, n;
+    while ((n = reader.next(records.data(), records.size())) > 0) {
+        // Payloads are views into the mapped segment: validated where they lie
+        for (size_t i = 0; i < n; ++i) {
+            const CardResult res = validate_card_quiet(records[i].payload);
+            valid += res.valid;
+            low_confidence += res.valid && res.low_confidence;
+
+            char line[kMaxResultRecord];
+            char *p = std::to_chars(line, line + 20, records[i].offset).ptr;
+            *p++ = ',';
+            const std::string_view label = result_label(res), issuer = res.issuer.substr(0, 16);
+            p = std::copy(label.begin(), label.end(), p);
+            *p++ = ',';
+            p = std::copy(issuer.begin(), issuer.end(), p);
+            *p++ = ',';
+            p = std::to_chars(p, line + sizeof(line), res.entropy, std::chars_format::fixed, 2).ptr;
+            if (!writer.append(std::string_view(line, static_cast<size_t>(p - line)))) return false;
+        }
+        total += n;
+        if (!writer.flush()) return false;
+
+        // Results are in the output log before the offsets that cover them are committed
+        if (++batches % kCommitBatches == 0 && !group.commit(partition, {reader.position(), writer.next_offset()}))
+            return false;
+    }
+    if (!writer.flush() || !group.commit(partition, {reader.position(), writer.next_offset()})) return false;
+
+    group.total += total;
+    group.valid += valid;
+    group.low_confidence += low_confidence;
+    return true;
+}
+
+} // namespace
+
+int run_log_consume(const std::string &log, const std::string &out, const std::string &group_name, size_t threads) {
+    const uint32_t partitions = count_partitions(log);
+    if (partitions == 0) {
+        std::cerr << "[ERROR] No partitions (partition-0, ...) under " << log << "\n";
+        return 1;
+    }
+    ConsumerGroup group;
+    group.offsets_path = log + "/" + group_name + ".offsets";
+    if (!load_offsets(group.offsets_path, group.committed)) return 1;
+    group.committed.resize(std::max<size_t>(group.committed.size(), partitions));
+
+    // Partitions are independent, so each thread takes whole partitions
+    threads = std::clamp<size_t>(threads, 1, partitions);
+    std::atomic<uint32_t> next_partition{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (uint32_t p; (p = next_partition.fetch_add(1)) < partitions;)
+                if (!consume_partition(log, out, p, group)) group.failed = true;
+        });
+    }
+    for (std::thread &w : workers) w.join();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
+                  .count();
+    if (group.failed) return 1;
+
+    const uint64_t total = group.total, valid = group.valid, low = group.low_confidence;
+    std::cout << "[RESULT] " << total << " cards: " << (valid - low) << " valid, " << low
+              << " valid (low confidence), " << (total - valid) << " invalid\n";
+    std::cout << "[TIME] Log consumed in " << ns << " ns (" << (total ? ns / static_cast<long long>(total) : 0)
+              << " ns/card)\n";
+    std::cout << "[INFO] Group " << group_name << ": " << partitions << " partition(s), " << threads
+              << " thread(s), " << group.commits << " offset commit(s) to " << group.offsets_path << "\n";
+    return 0;
+}
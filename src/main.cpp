@@ -1,7 +1,553 @@
 #include "validator.h"
+#include "arrow_sink.h"
+#include "checkpoint.h"
+#include "columnar.h"
+#include "compressed_input.h"
+#include "correction.h"
+#include "digit_scan.h"
+#include "generator.h"
+#include "http.h"
+#include "huge_pages.h"
+#include "metrics.h"
+#include "mod10.h"
+#include "pipeline.h"
+#include "policy.h"
+#include "profiler.h"
+#include "segment_log.h"
+#include "shm_channel.h"
+#include "shm_client.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+ * Usage:
+ *   card_validator                                  interactive: type one card number
+ *   card_validator --batch FILE [options]           validate one card number per line
+ *       --metrics TARGET     dump per-stage histograms when the batch finishes
+ *       --output FILE        write one "<line>,<result>,<issuer>,<entropy>" row per card
+ *       --columnar-out FILE  write results in the columnar binary format (columnar.h)
+ *       --arrow-out FILE     write results as an Apache Arrow IPC stream (arrow_sink.h)
+ *       --csv COLUMN         input is CSV with a header row; the PAN is in COLUMN (ingest.h)
+ *       --jsonl KEY          input is one JSON object per line; the PAN is under KEY
+ *       --passthrough        with --csv/--jsonl: --output keeps the other fields of each record
+ *       --checkpoint FILE    save progress every few seconds; a rerun resumes there (checkpoint.h)
+ *       --incremental FILE   like --checkpoint, but kept after success: reruns only see appended records
+ *       --checkpoint-interval SECONDS   how often to save (default 5)
+ *       --threads N          validation workers (default: one per hardware thread)
+ *       --batch-size N       records handed between pipeline stages at a time
+ *       --numa auto|on|off   one worker group per NUMA node (numa_topology.h; default auto)
+ *   --policy FILE                                   decide valid/low confidence/invalid by FILE's rules (policy.h);
+ *                                                   works with every mode
+ *   --type card|imei|npi|sin|gtin|iban              what the numbers are (mod10.h, iban.h; default card); works
+ *                                                   with interactive, batch, --shm-serve and --http-serve
+ *   --huge-pages off|thp|hugetlb                    2 MiB pages for batch trays, big policy tables and mapped
+ *                                                   input (huge_pages.h; default off); batch mode reports
+ *                                                   the pages, page faults and dTLB misses it ended up with
+ *   --lock-memory                                   servers mlock() the tables and channel they prefault at start
+ *   --kernel fused|staged                           one SIMD pass over the digits for every check, or each check
+ *                                                   on its own (digit_scan.h; default fused)
+ *   card_validator --generate N --output FILE       write N Luhn-valid test numbers, one per line (generator.h)
+ *       --issuer LIST        e.g. VISA,AMEX (default VISA,MASTERCARD; every issuer must allow --length)
+ *       --length L           digits per number (default 16)
+ *       --entropy-digits K   body digits drawn from only K distinct digits (default 10)
+ *       --repeat-fraction F  share of numbers with a back-to-back repeated block (default 0)
+ *       --seed S             same seed, same numbers (default 1)
+ *       --threads N          generator threads (default: one per hardware thread)
+ *   card_validator --check-digit DIGITS             the Luhn digit that completes DIGITS (correction.h)
+ *   card_validator --suggest NUMBER                 likely intended numbers for one typo or swapped pair
+ *   card_validator --profile FILE                   hardware counters per stage and PAN length
+ *   card_validator --columnar-scan FILE             count outcomes straight from a columnar file
+ *   card_validator --shm-serve NAME                 serve co-located clients over shared memory
+ *   card_validator --shm-bench NAME                 round-trip benchmark against --shm-serve
+ *   card_validator --http-serve [HOST:]PORT         answer POST /validate (JSON array) over HTTP/1.1 (http.h)
+ *       --threads N          compute threads for large batches (default: one per hardware thread)
+ *   card_validator --http-bench [HOST:]PORT         requests/s and p99 against --http-serve
+ *   card_validator --log-append FILE --log LOG      append FILE's lines as records to segment log LOG
+ *       --partitions P       spread them round-robin over P partitions (default: LOG's count, or 1)
+ *       --segment-bytes N    start a new segment file past N bytes (default 64 MiB)
+ *   card_validator --log-consume LOG --log-out OUT  validate LOG's uncommitted records into log OUT (segment_log.h)
+ *       --group NAME         consumer group whose offsets are committed (default cardguard)
+ *       --threads N          partitions consumed in parallel (default: one per hardware thread)
+ *
+ * FILE may be "-" for standard input. A gzip or zstd compressed FILE is
+ * decompressed on the fly (in parallel when it has several frames). TARGET is a file path, "unix:/path"
+ * or "tcp:host:port"; the per-stage histograms are dumped there in
+ * Prometheus text format when the batch finishes.
+ */
+
+static void print_usage() {
+    std::cerr << "Usage: card_validator [--batch FILE [--metrics TARGET] [--output FILE] [--threads N]\n"
+                 "                       [--batch-size N] [--numa auto|on|off] [--columnar-out FILE] [--arrow-out FILE]\n"
+                 "                       [--csv COLUMN | --jsonl KEY] [--passthrough]\n"
+                 "                       [--checkpoint FILE | --incremental FILE] [--checkpoint-interval SECONDS]]\n"
+                 "                      [--profile FILE] [--columnar-scan FILE] [--shm-serve NAME] [--shm-bench NAME]\n"
+                 "                      [--http-serve [HOST:]PORT] [--http-bench [HOST:]PORT]\n"
+                 "       card_validator --log-append FILE --log LOG [--partitions P] [--segment-bytes N]\n"
+                 "       card_validator --log-consume LOG --log-out OUT [--group NAME] [--threads N]\n"
+                 "                      [--policy FILE] [--type card|imei|npi|sin|gtin|iban]\n"
+                 "                      [--huge-pages off|thp|hugetlb] [--lock-memory] [--kernel fused|staged]\n"
+                 "       card_validator --generate N --output FILE [--issuer LIST] [--length L] [--entropy-digits K]\n"
+                 "                      [--repeat-fraction F] [--seed S] [--threads N]\n"
+                 "       card_validator --check-digit DIGITS | --suggest NUMBER\n";
+}
+
+// A flag's numeric value: the whole argument must be a number that fits in
+// `value` ("8", "0.5"; not "x", "8k" or "-1" for a count). Otherwise an
+// [ERROR] and the usage, and `value` keeps its default.
+template <typename T>
+static bool parse_flag_value(const std::string &flag, const char *text, T &value) {
+    const char *end = text + std::strlen(text);
+    T parsed{};
+    const auto [ptr, ec] = std::from_chars(text, end, parsed);
+    if (ec != std::errc() || ptr != end || ptr == text) {
+        std::cerr << "[ERROR] Invalid " << flag << " '" << text << "' (expected a number)\n";
+        print_usage();
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Open FILE, or hand back std::cin for "-"; nullptr (after an [ERROR]) if it can't be read.
+// A .gz / .zst file (recognised by its first bytes) is decompressed on the fly
+// by `threads` decoder threads.
+static std::istream *open_input(const std::string &path, std::ifstream &file, CompressedInput &compressed,
+                                size_t threads) {
+    if (path == "-") return &std::cin;
+    file.open(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "[ERROR] Could not open " << path << "\n";
+        return nullptr;
+    }
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+    const size_t got = static_cast<size_t>(file.gcount());
+    if (detect_compression(magic, got) != Compression::None) {
+        file.close();
+        if (!compressed.open(path, threads)) return nullptr;
+        return &compressed.stream();
+    }
+    file.clear();
+    file.seekg(0);
+    return &file;
+}
+
+static size_t default_threads(size_t requested) {
+    return requested ? requested : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Profile mode: load the whole file first so disk reads don't pollute the counters
+static int run_profile_file(const std::string &path) {
+    std::ifstream file;
+    CompressedInput compressed;
+    std::istream *in = open_input(path, file, compressed, default_threads(0));
+    if (!in) return 1;
+
+    std::vector<std::string> cards;
+    std::string line;
+    while (std::getline(*in, line))
+        if (!line.empty()) cards.push_back(line);
+
+    return run_profile(cards, std::cout);
+}
+
+// Where batch mode sends its results besides the console summary
+struct BatchOutputs {
+    std::string text_path;      // --output
+    std::string columnar_path;  // --columnar-out
+    std::string arrow_path;     // --arrow-out
+    std::string metrics_target; // --metrics
+    std::string checkpoint_path;  // --checkpoint / --incremental
+    bool incremental = false;     // Keep the final checkpoint so the next run only sees new records
+    double checkpoint_interval = 5.0;
+    std::string policy_path;      // --policy (also part of the checkpoint identity)
+    bool page_report = false;     // --huge-pages given: report pages, page faults and dTLB misses
+};
+
+// What a checkpoint must match to be resumed: same input, same parsing, same output file
+static CheckpointState checkpoint_identity(const std::string &path, const BatchOutputs &outputs,
+                                           const InputSpec &input) {
+    CheckpointState identity;
+    identity.input = path;
+    identity.format = input.format == InputFormat::Csv     ? "csv:" + input.field
+                      : input.format == InputFormat::Jsonl ? "jsonl:" + input.field
+                                                           : "lines";
+    if (input.passthrough) identity.format += "+passthrough";
+    if (active_id_type() != IdType::Card) identity.format += "+type:" + std::string(id_type_name(active_id_type()));
+    if (!outputs.policy_path.empty()) {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(active_policy().fingerprint()));
+        identity.format += "+policy:" + std::string(hash);
+    }
+    identity.output = outputs.text_path;
+    return identity;
+}
+
+// Can the run pick up from `saved`? Checks the identity, that --output still
+// holds what the checkpoint says was written, and that the input still starts
+// with exactly the bytes already validated (CRC-32 of the prefix). For CSV it
+// also hands back the header record, which the resumed run won't read again.
+static bool can_resume(const CheckpointState &saved, const CheckpointState &identity, size_t threads,
+                       std::string &csv_header) {
+    if (saved.input != identity.input || saved.format != identity.format || saved.output != identity.output) {
+        std::cout << "[INFO] Checkpoint is for a different input or options; starting over\n";
+        return false;
+    }
+    if (!saved.output.empty()) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(saved.output, ec);
+        if (ec || size < saved.output_bytes) {
+            std::cout << "[INFO] " << saved.output << " is shorter than the checkpoint expects; starting over\n";
+            return false;
+        }
+    }
+
+    std::ifstream file;
+    CompressedInput compressed;
+    std::istream *in = open_input(saved.input, file, compressed, threads);
+    if (!in) return false;
+    uint32_t crc = 0;
+    uint64_t remaining = saved.offset;
+    if (identity.format.rfind("csv:", 0) == 0 && saved.offset > 0) {
+        std::getline(*in, csv_header);
+        csv_header += '\n';
+        crc = crc32_update(crc, csv_header.data(), csv_header.size());
+        remaining -= std::min<uint64_t>(remaining, csv_header.size());
+    }
+    if (!hash_prefix(*in, remaining, crc) || crc != saved.crc) {
+        std::cout << "[INFO] " << saved.input << " changed since the checkpoint; starting over\n";
+        return false;
+    }
+    return true;
+}
+
+// Batch mode: the same checks as validate_card(), but silent per card, run
+// through the staged pipeline (reader -> workers -> formatter -> writer).
+// Per-card lines go to --output if given; the console only gets a summary
+// (printing 1M [INFO] lines would be the bottleneck).
+static int run_batch(const std::string &path, const BatchOutputs &outputs, PipelineOptions options) {
+    // Columnar and Arrow files hold card issuer ids and entropy; other types have neither
+    if (active_id_type() != IdType::Card && (!outputs.columnar_path.empty() || !outputs.arrow_path.empty())) {
+        std::cerr << "[ERROR] --columnar-out/--arrow-out hold card results only, not " << id_type_name(active_id_type())
+                  << "; use --output\n";
+        return 1;
+    }
+
+    std::ifstream file;
+    CompressedInput compressed;
+    std::istream *in = open_input(path, file, compressed, default_threads(options.workers));
+    if (!in) return 1;
+
+    // Checkpointed run: resume from the last checkpoint if it still matches
+    const bool checkpointing = !outputs.checkpoint_path.empty();
+    const CheckpointState identity = checkpoint_identity(path, outputs, options.input);
+    CheckpointState saved;
+    bool resuming = false;
+    if (checkpointing) {
+        if (path == "-" || !outputs.columnar_path.empty() || !outputs.arrow_path.empty()) {
+            std::cerr << "[ERROR] --checkpoint/--incremental need an input file and can only resume --output\n";
+            return 1;
+        }
+        if (load_checkpoint(outputs.checkpoint_path, saved))
+            resuming = can_resume(saved, identity, default_threads(options.workers), options.csv_header);
+        if (resuming) {
+            options.resume = saved;
+            if (in == &file) file.seekg(static_cast<std::streamoff>(saved.offset));
+            else in->ignore(static_cast<std::streamsize>(saved.offset));
+            if (!saved.output.empty()) std::filesystem::resize_file(saved.output, saved.output_bytes);
+            std::cout << "[INFO] Resuming at line " << saved.line << " (byte " << saved.offset << ", "
+                      << saved.total << " cards already validated)\n";
+        } else {
+            options.csv_header.clear();
+        }
+        options.hold_partial_tail = outputs.incremental;
+    }
+    Checkpointer checkpointer(outputs.checkpoint_path, identity, outputs.checkpoint_interval);
+    if (checkpointing) options.checkpoint = &checkpointer;
+
+    std::ofstream output;
+    if (!outputs.text_path.empty()) {
+        output.open(outputs.text_path, resuming ? std::ios::app : std::ios::trunc);
+        if (!output) {
+            std::cerr << "[ERROR] Could not open " << outputs.text_path << " for writing\n";
+            return 1;
+        }
+        options.output = &output;
+    }
+
+    ColumnarWriter columnar;
+    if (!outputs.columnar_path.empty()) {
+        if (!columnar.open(outputs.columnar_path)) return 1;
+        options.sinks.push_back(&columnar);
+    }
+
+    std::ofstream arrow_file;
+    ArrowStreamWriter arrow(arrow_file);
+    if (!outputs.arrow_path.empty()) {
+        arrow_file.open(outputs.arrow_path, std::ios::binary | std::ios::trunc);
+        if (!arrow_file) {
+            std::cerr << "[ERROR] Could not open " << outputs.arrow_path << " for writing\n";
+            return 1;
+        }
+        options.sinks.push_back(&arrow);
+    }
+
+    if (!outputs.metrics_target.empty()) set_metrics_enabled(true);
+
+    // Opened before the pipeline starts its threads, so it follows all of them
+    std::unique_ptr<InheritedCounter> dtlb_misses;
+    if (outputs.page_report) dtlb_misses = std::make_unique<InheritedCounter>(PerfEvent::DTLBMisses);
+    const uint64_t faults_before = page_faults();
+
+    auto start_time = std::chrono::steady_clock::now();
+    PipelineStats stats = run_pipeline(*in, options);
+    if (stats.input_error) return 1;
+    if (compressed.failed()) {
+        std::cerr << "[ERROR] " << path << ": " << compressed.error() << "\n";
+        return 1;
+    }
+    if (checkpointing) {
+        // Done: --incremental keeps the end position for next time; a plain
+        // checkpoint has served its purpose
+        if (outputs.incremental) {
+            stats.progress.complete = true;
+            if (!checkpointer.save(stats.progress)) return 1;
+        } else {
+            std::remove(outputs.checkpoint_path.c_str());
+        }
+        if (resuming)
+            std::cout << "[INFO] " << (stats.total - saved.total) << " card(s) validated since the checkpoint\n";
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start_time).count();
+
+    const uint64_t total = stats.total, valid = stats.valid, low_confidence = stats.low_confidence;
+    std::cout << "[RESULT] " << total << " cards: " << (valid - low_confidence) << " valid, "
+              << low_confidence << " valid (low confidence), " << (total - valid) << " invalid\n";
+    std::cout << "[TIME] Batch completed in " << ns << " ns ("
+              << (total ? ns / static_cast<long long>(total) : 0) << " ns/card)\n";
+    if (stats.missing_field)
+        std::cout << "[INFO] " << stats.missing_field << " record(s) had no \"" << options.input.field
+                  << "\" field (counted as invalid)\n";
+    if (compressed.compression() != Compression::None)
+        std::cout << "[INFO] Decompressed " << compressed.decompressed_bytes() << " bytes of "
+                  << compression_name(compressed.compression()) << " input (" << compressed.frames()
+                  << " frame(s), " << compressed.decoder_threads() << " decoder thread(s))\n";
+    print_pipeline_stats(std::cout, stats);
+    if (outputs.page_report) {
+        std::cout << "[PIPELINE] Pages: " << stats.huge_page_bytes / (1024 * 1024) << " MiB in huge pages, "
+                  << page_faults() - faults_before << " page faults, ";
+        if (dtlb_misses->available() && total)
+            std::cout << std::fixed << std::setprecision(2) << double(dtlb_misses->read()) / double(total)
+                      << " dTLB misses/card\n";
+        else
+            std::cout << "dTLB misses n/a (perf_event_open refused)\n";
+        if (hugetlb_fallbacks())
+            std::cout << "[INFO] " << hugetlb_fallbacks() << " mapping(s) found no free hugetlb page "
+                         "(/proc/sys/vm/nr_hugepages) and used transparent huge pages\n";
+    }
+
+    for (ResultSink *sink : options.sinks)
+        if (!sink->finish()) return 1;
+    if (!outputs.columnar_path.empty())
+        std::cout << "[INFO] Columnar results written to " << outputs.columnar_path << "\n";
+    if (!outputs.arrow_path.empty())
+        std::cout << "[INFO] Arrow stream (" << arrow.rows() << " rows) written to " << outputs.arrow_path << "\n";
+
+    if (!outputs.metrics_target.empty()) {
+        if (!dump_metrics(outputs.metrics_target)) return 1;
+        std::cout << "[INFO] Stage metrics written to " << outputs.metrics_target << "\n";
+    }
+    return 0;
+}
+
+// Servers: fault the policy tables in before the first request arrives (and
+// pin them with --lock-memory), so no early request waits on a page fault
+static void prepare_server_memory() {
+    const Policy &policy = active_policy();
+    const bool lock = memory_options().lock;
+    if (!policy.prefault_tables(lock)) {
+        std::cout << "[INFO] Could not lock the policy tables in memory (" << std::strerror(errno)
+                  << "); raise ulimit -l or grant CAP_IPC_LOCK\n";
+        return;
+    }
+    std::cout << "[INFO] Policy tables (" << policy.tables_bytes() / 1024 << " KiB) faulted in"
+              << (lock ? " and locked" : "") << "\n";
+}
+
+int main(int argc, char **argv) {
+    std::string batch_path, profile_path, shm_serve, shm_bench, http_serve, http_bench, columnar_scan, check_digit,
+        suggest;
+    BatchOutputs outputs;
+    PipelineOptions pipeline;
+    GeneratorOptions generator;
+    MemoryOptions memory;
+    bool generate = false, check_digit_given = false, suggest_given = false;
+    std::string log_append, log_dir, log_consume, log_out, log_group = "cardguard";
+    uint32_t log_partitions = 0;
+    uint64_t segment_bytes = kDefaultSegmentBytes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) batch_path = argv[++i];
+        else if (arg == "--metrics" && i + 1 < argc) outputs.metrics_target = argv[++i];
+        else if (arg == "--profile" && i + 1 < argc) profile_path = argv[++i];
+        else if (arg == "--shm-serve" && i + 1 < argc) shm_serve = argv[++i];
+        else if (arg == "--shm-bench" && i + 1 < argc) shm_bench = argv[++i];
+        else if (arg == "--http-serve" && i + 1 < argc) http_serve = argv[++i];
+        else if (arg == "--http-bench" && i + 1 < argc) http_bench = argv[++i];
+        else if (arg == "--log-append" && i + 1 < argc) log_append = argv[++i];
+        else if (arg == "--log" && i + 1 < argc) log_dir = argv[++i];
+        else if (arg == "--partitions" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], log_partitions)) return 2;
+        } else if (arg == "--segment-bytes" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], segment_bytes)) return 2;
+        } else if (arg == "--log-consume" && i + 1 < argc) log_consume = argv[++i];
+        else if (arg == "--log-out" && i + 1 < argc) log_out = argv[++i];
+        else if (arg == "--group" && i + 1 < argc) log_group = argv[++i];
+        else if (arg == "--output" && i + 1 < argc) outputs.text_path = argv[++i];
+        else if (arg == "--columnar-out" && i + 1 < argc) outputs.columnar_path = argv[++i];
+        else if (arg == "--arrow-out" && i + 1 < argc) outputs.arrow_path = argv[++i];
+        else if (arg == "--columnar-scan" && i + 1 < argc) columnar_scan = argv[++i];
+        else if (arg == "--csv" && i + 1 < argc) {
+            pipeline.input.format = InputFormat::Csv;
+            pipeline.input.field = argv[++i];
+        } else if (arg == "--jsonl" && i + 1 < argc) {
+            pipeline.input.format = InputFormat::Jsonl;
+            pipeline.input.field = argv[++i];
+        } else if (arg == "--passthrough") pipeline.input.passthrough = true;
+        else if (arg == "--checkpoint" && i + 1 < argc) outputs.checkpoint_path = argv[++i];
+        else if (arg == "--incremental" && i + 1 < argc) {
+            outputs.checkpoint_path = argv[++i];
+            outputs.incremental = true;
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], outputs.checkpoint_interval)) return 2;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], pipeline.workers)) return 2;
+        } else if (arg == "--batch-size" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], pipeline.batch_size)) return 2;
+        } else if (arg == "--numa" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "auto") pipeline.numa = NumaMode::Auto;
+            else if (mode == "on") pipeline.numa = NumaMode::On;
+            else if (mode == "off") pipeline.numa = NumaMode::Off;
+            else {
+                std::cerr << "[ERROR] Unknown --numa '" << mode << "' (auto, on or off)\n";
+                return 2;
+            }
+        } else if (arg == "--huge-pages" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "off") memory.huge_pages = HugePages::Off;
+            else if (mode == "thp") memory.huge_pages = HugePages::Transparent;
+            else if (mode == "hugetlb") memory.huge_pages = HugePages::Explicit;
+            else {
+                std::cerr << "[ERROR] Unknown --huge-pages '" << mode << "' (off, thp or hugetlb)\n";
+                return 2;
+            }
+            outputs.page_report = true;
+        } else if (arg == "--lock-memory") memory.lock = true;
+        else if (arg == "--kernel" && i + 1 < argc) {
+            const std::string kernel = argv[++i];
+            if (kernel == "fused") set_digit_kernel(DigitKernel::Fused);
+            else if (kernel == "staged") set_digit_kernel(DigitKernel::Staged);
+            else {
+                std::cerr << "[ERROR] Unknown --kernel '" << kernel << "' (fused or staged)\n";
+                return 2;
+            }
+        }
+        else if (arg == "--policy" && i + 1 < argc) outputs.policy_path = argv[++i];
+        else if (arg == "--type" && i + 1 < argc) {
+            bool ok = false;
+            set_active_id_type(id_type_from_name(argv[++i], ok));
+            if (!ok) {
+                std::cerr << "[ERROR] Unknown --type '" << argv[i] << "' (card, imei, npi, sin, gtin or iban)\n";
+                return 2;
+            }
+        }
+        else if (arg == "--generate" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], generator.count)) return 2;
+            generate = true;
+        } else if (arg == "--issuer" && i + 1 < argc) {
+            if (!parse_issuer_list(argv[++i], generator.issuers)) {
+                std::cerr << "[ERROR] Unknown issuer in '" << argv[i] << "'\n";
+                return 2;
+            }
+        } else if (arg == "--length" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], generator.length)) return 2;
+        } else if (arg == "--entropy-digits" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], generator.entropy_digits)) return 2;
+        } else if (arg == "--repeat-fraction" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], generator.repeat_fraction)) return 2;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            if (!parse_flag_value(arg, argv[++i], generator.seed)) return 2;
+        } else if (arg == "--check-digit" && i + 1 < argc) {
+            check_digit = argv[++i];
+            check_digit_given = true;
+        } else if (arg == "--suggest" && i + 1 < argc) {
+            suggest = argv[++i];
+            suggest_given = true;
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    set_memory_options(memory); // Before the policy tables are built
+
+    if (!outputs.policy_path.empty()) {
+        Policy policy;
+        if (!policy.load(outputs.policy_path)) return 1;
+        set_active_policy(policy); // Before any validation thread starts
+        std::cout << "[INFO] Policy " << outputs.policy_path << ": " << policy.rule_count() << " rule(s), "
+                  << policy.blocklist_size() << " blocked prefix(es), "
+                  << (policy.table_bytes() ? std::to_string(policy.table_bytes()) + "-byte decision table"
+                                           : std::string("rule scan")) << "\n";
+    }
+
+    if (check_digit_given) return run_check_digit(check_digit);
+    if (suggest_given) return run_suggest(suggest);
+    if (generate) {
+        generator.threads = default_threads(pipeline.workers);
+        return run_generate(generator, outputs.text_path);
+    }
+    if (!log_append.empty()) {
+        if (log_dir.empty()) {
+            std::cerr << "[ERROR] --log-append needs --log LOG\n";
+            return 2;
+        }
+        return run_log_append(log_append, log_dir, log_partitions, segment_bytes);
+    }
+    if (!log_consume.empty()) {
+        if (log_out.empty()) {
+            std::cerr << "[ERROR] --log-consume needs --log-out OUT\n";
+            return 2;
+        }
+        return run_log_consume(log_consume, log_out, log_group, default_threads(pipeline.workers));
+    }
+    if (!profile_path.empty()) return run_profile_file(profile_path);
+    if (!shm_serve.empty()) {
+        prepare_server_memory();
+        return run_shm_server(shm_serve);
+    }
+    if (!shm_bench.empty()) return run_shm_benchmark(shm_bench);
+    if (!http_serve.empty()) {
+        prepare_server_memory();
+        return run_http_server(http_serve, default_threads(pipeline.workers));
+    }
+    if (!http_bench.empty()) return run_http_benchmark(http_bench);
+    if (!columnar_scan.empty()) return run_columnar_scan(columnar_scan);
+    if (!batch_path.empty()) return run_batch(batch_path, outputs, pipeline);
 
-int main() {
     std::string input;
     std::cout << "Enter a credit card number: ";
     std::getline(std::cin, input);  // Read the entire line including spaces
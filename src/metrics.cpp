@@ -0,0 +1,304 @@
+#include "metrics.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* ---------------------
+   Per-thread Counters
+---------------------- */
+
+// One thread's private scoreboard. It is padded to its own cache lines so two
+// threads never fight over the same line ("false sharing") while counting.
+// Only the owning thread writes; merge_metrics() reads with relaxed loads.
+struct alignas(64) ThreadMetrics {
+    struct StageCounters {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum_cycles{0};
+        std::array<std::atomic<uint64_t>, kHistogramBuckets> buckets{};
+    };
+    std::array<StageCounters, kStageCount> stages{};
+    std::atomic<uint64_t> cards_valid{0};
+    std::atomic<uint64_t> cards_low_confidence{0};
+    std::atomic<uint64_t> cards_invalid{0};
+};
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+std::atomic<uint32_t> g_sample_period{64};
+
+// The registry is a guest book: each thread signs it once (under the lock),
+// and the scoreboards stay alive after the thread exits so nothing is lost.
+std::mutex g_registry_mutex;
+std::vector<std::shared_ptr<ThreadMetrics>> g_registry;
+
+ThreadMetrics &local_metrics() {
+    thread_local std::shared_ptr<ThreadMetrics> mine = [] {
+        auto m = std::make_shared<ThreadMetrics>();
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        g_registry.push_back(m);
+        return m;
+    }();
+    return *mine;
+}
+
+// Single-writer increment: a plain load + store is enough (and much cheaper
+// than a locked fetch_add) because no other thread ever writes this counter.
+inline void bump(std::atomic<uint64_t> &counter, uint64_t by = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+// Measure how many cycles tick per second by timing a short sleep
+double calibrate_cycles_per_second() {
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    uint64_t c0 = read_cycles();
+    while (clock::now() - t0 < std::chrono::milliseconds(10)) {
+    }
+    uint64_t c1 = read_cycles();
+    auto t1 = clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return seconds > 0 ? double(c1 - c0) / seconds : 1.0;
+}
+
+double cycles_per_second() {
+    static const double hz = calibrate_cycles_per_second();
+    return hz;
+}
+
+} // namespace
+
+/* ---------------------
+   Public API
+---------------------- */
+
+const char *stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::Normalize: return "normalize";
+        case Stage::Length: return "length";
+        case Stage::Issuer: return "issuer";
+        case Stage::Luhn: return "luhn";
+        case Stage::Entropy: return "entropy";
+        case Stage::Repetition: return "repetition";
+        case Stage::Policy: return "policy";
+        case Stage::Scan: return "scan";
+        default: return "unknown";
+    }
+}
+
+uint64_t histogram_bucket_limit(size_t bucket) {
+    if (bucket < (1u << kSubBucketBits)) return bucket + 1;
+    size_t group = bucket >> kSubBucketBits;
+    uint64_t sub = bucket & ((1u << kSubBucketBits) - 1);
+    uint64_t mantissa = (1u << kSubBucketBits) + sub + 1;
+    unsigned shift = static_cast<unsigned>(group - 1);
+    // The very last buckets would overflow 64 bits: treat them as "infinity"
+    if (shift + 3 >= 64) return UINT64_MAX;
+    return mantissa << shift;
+}
+
+uint64_t StageSnapshot::percentile_cycles(double q) const {
+    if (count == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(q * double(count));
+    if (target >= count) target = count - 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen > target) return histogram_bucket_limit(b);
+    }
+    return histogram_bucket_limit(buckets.size() - 1);
+}
+
+void set_metrics_enabled(bool enabled) {
+    if (enabled) cycles_per_second(); // Calibrate now, not in the middle of a batch
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool metrics_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void set_metrics_sample_period(uint32_t period) {
+    g_sample_period.store(period ? period : 1, std::memory_order_relaxed);
+}
+
+bool metrics_sample_card() {
+    if (!metrics_enabled()) return false;
+    // A per-thread countdown: cheaper than a random number and no shared state
+    thread_local uint32_t countdown = 0;
+    if (countdown == 0) {
+        countdown = g_sample_period.load(std::memory_order_relaxed) - 1;
+        return true;
+    }
+    --countdown;
+    return false;
+}
+
+void record_stage(Stage stage, uint64_t cycles) {
+    auto &s = local_metrics().stages[static_cast<size_t>(stage)];
+    bump(s.count);
+    bump(s.sum_cycles, cycles);
+    bump(s.buckets[histogram_bucket(cycles)]);
+}
+
+void record_card_outcome(bool valid, bool low_confidence) {
+    if (!metrics_enabled()) return;
+    auto &m = local_metrics();
+    if (!valid) bump(m.cards_invalid);
+    else if (low_confidence) bump(m.cards_low_confidence);
+    else bump(m.cards_valid);
+}
+
+MetricsSnapshot merge_metrics() {
+    MetricsSnapshot snap;
+    snap.cycles_per_second = cycles_per_second();
+    snap.sample_period = g_sample_period.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (const auto &m : g_registry) {
+        for (size_t i = 0; i < kStageCount; ++i) {
+            const auto &src = m->stages[i];
+            auto &dst = snap.stages[i];
+            dst.count += src.count.load(std::memory_order_relaxed);
+            dst.sum_cycles += src.sum_cycles.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < kHistogramBuckets; ++b)
+                dst.buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+        }
+        snap.cards_valid += m->cards_valid.load(std::memory_order_relaxed);
+        snap.cards_low_confidence += m->cards_low_confidence.load(std::memory_order_relaxed);
+        snap.cards_invalid += m->cards_invalid.load(std::memory_order_relaxed);
+    }
+    snap.cards_total = snap.cards_valid + snap.cards_low_confidence + snap.cards_invalid;
+    return snap;
+}
+
+void write_prometheus(std::ostream &out, const MetricsSnapshot &snap) {
+    out << "# HELP cardguard_cards_total Cards validated, by outcome.\n"
+        << "# TYPE cardguard_cards_total counter\n"
+        << "cardguard_cards_total{result=\"valid\"} " << snap.cards_valid << "\n"
+        << "cardguard_cards_total{result=\"low_confidence\"} " << snap.cards_low_confidence << "\n"
+        << "cardguard_cards_total{result=\"invalid\"} " << snap.cards_invalid << "\n";
+
+    out << "# HELP cardguard_stage_sample_period One card in this many has its stages timed.\n"
+        << "# TYPE cardguard_stage_sample_period gauge\n"
+        << "cardguard_stage_sample_period " << snap.sample_period << "\n";
+
+    out << "# HELP cardguard_stage_seconds Time spent in each validate_card() stage.\n"
+        << "# TYPE cardguard_stage_seconds histogram\n";
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const StageSnapshot &s = snap.stages[i];
+        const char *name = stage_name(static_cast<Stage>(i));
+
+        // Only emit buckets that actually hold samples (plus the cumulative
+        // running total), otherwise we'd print 256 mostly-zero lines per stage
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < kHistogramBuckets; ++b) {
+            if (s.buckets[b] == 0) continue;
+            cumulative += s.buckets[b];
+            uint64_t limit = histogram_bucket_limit(b);
+            if (limit == UINT64_MAX) break;
+            out << "cardguard_stage_seconds_bucket{stage=\"" << name << "\",le=\""
+                << double(limit) / snap.cycles_per_second << "\"} " << cumulative << "\n";
+        }
+        out << "cardguard_stage_seconds_bucket{stage=\"" << name << "\",le=\"+Inf\"} " << s.count << "\n"
+            << "cardguard_stage_seconds_sum{stage=\"" << name << "\"} "
+            << double(s.sum_cycles) / snap.cycles_per_second << "\n"
+            << "cardguard_stage_seconds_count{stage=\"" << name << "\"} " << s.count << "\n";
+    }
+
+    out << "# HELP cardguard_stage_p99_cycles 99th percentile stage latency in CPU cycles.\n"
+        << "# TYPE cardguard_stage_p99_cycles gauge\n";
+    for (size_t i = 0; i < kStageCount; ++i) {
+        out << "cardguard_stage_p99_cycles{stage=\"" << stage_name(static_cast<Stage>(i)) << "\"} "
+            << snap.stages[i].percentile_cycles(0.99) << "\n";
+    }
+}
+
+/* ---------------------
+   Export Targets
+---------------------- */
+
+namespace {
+
+// Connect a socket to "unix:/path" or "tcp:host:port"; returns -1 on failure
+int connect_target(const std::string &target) {
+    if (target.rfind("unix:", 0) == 0) {
+        std::string path = target.substr(5);
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) return -1;
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // "tcp:host:port" -> split on the LAST colon so the host part stays intact
+    std::string rest = target.substr(4);
+    size_t colon = rest.rfind(':');
+    if (colon == std::string::npos) return -1;
+    std::string host = rest.substr(0, colon), port = rest.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return -1;
+    int fd = -1;
+    for (addrinfo *ai = found; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(found);
+    return fd;
+}
+
+} // namespace
+
+bool dump_metrics(const std::string &target) {
+    std::ostringstream text;
+    write_prometheus(text, merge_metrics());
+    const std::string body = text.str();
+
+    if (target.rfind("unix:", 0) == 0 || target.rfind("tcp:", 0) == 0) {
+        int fd = connect_target(target);
+        if (fd < 0) {
+            std::cerr << "[ERROR] Could not connect to metrics target " << target << "\n";
+            return false;
+        }
+        size_t sent = 0;
+        while (sent < body.size()) {
+            ssize_t n = ::send(fd, body.data() + sent, body.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        if (sent != body.size()) {
+            std::cerr << "[ERROR] Metrics write to " << target << " was cut short\n";
+            return false;
+        }
+        return true;
+    }
+
+    std::ofstream file(target, std::ios::trunc);
+    if (!file || !(file << body)) {
+        std::cerr << "[ERROR] Could not write metrics file " << target << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#include "mod10.h"
+#include "iban.h"
+#include "metrics.h"
+#include <array>
+
+/* ---------------------
+   The Identifier Table
+---------------------- */
+
+namespace {
+
+struct IdSpec {
+    const char *flag;     // --type value
+    const char *name;     // Shown in the issuer column
+    uint32_t lengths;     // Bit L set: L digits allowed
+    uint16_t first_digits; // Bit d set: may start with digit d
+    uint8_t prefix_sum;   // Checksum contribution of an implied prefix
+    bool luhn;            // Weight 2 with digit sums (else weight 3, GTIN style)
+};
+
+constexpr uint32_t bit(size_t n) { return uint32_t(1) << n; }
+
+// Indexed by IdType. The Card and Iban rows are only here for their names:
+// cards go through the issuer table and the full validator, IBANs through
+// validate_iban().
+constexpr std::array<IdSpec, static_cast<size_t>(IdType::Count)> kIdSpecs = {{
+    {"card", "CARD", 0, 0x3FF, 0, true},
+    {"imei", "IMEI", bit(15), 0x3FF, 0, true},
+    {"npi", "NPI", bit(10), bit(1) | bit(2), 24, true},               // "80840" + 10 digits
+    {"sin", "SIN", bit(9), 0x3FF & ~(bit(0) | bit(8)), 0, true},      // 0 unassigned, 8 unused
+    {"gtin", "GTIN", bit(8) | bit(12) | bit(13) | bit(14), 0x3FF, 0, false},
+    {"iban", "IBAN", 0, 0, 0, false},                                  // Names only: see iban.h
+}};
+
+IdType g_active_id_type = IdType::Card;
+
+} // namespace
+
+IdType id_type_from_name(std::string_view name, bool &ok) {
+    for (size_t i = 0; i < kIdSpecs.size(); ++i) {
+        if (name == kIdSpecs[i].flag) {
+            ok = true;
+            return static_cast<IdType>(i);
+        }
+    }
+    ok = false;
+    return IdType::Card;
+}
+
+const char *id_type_name(IdType type) {
+    return kIdSpecs[static_cast<size_t>(type) < kIdSpecs.size() ? static_cast<size_t>(type) : 0].name;
+}
+
+IdType active_id_type() { return g_active_id_type; }
+
+void set_active_id_type(IdType type) { g_active_id_type = type; }
+
+/* ---------------------
+   Validation
+---------------------- */
+
+bool identifier_valid(IdType type, std::string_view digits, bool &length_pass, bool &checksum_pass) {
+    const IdSpec &spec = kIdSpecs[static_cast<size_t>(type)];
+    const size_t n = digits.size();
+    // No length bits for the Card and Iban rows, so they simply fail here
+    // Length and first digit: two bit tests before any checksum work
+    length_pass = n < 32 && (spec.lengths >> n & 1) && (spec.first_digits >> (digits[0] - '0') & 1);
+    if (!length_pass) {
+        checksum_pass = false;
+        return false;
+    }
+    const unsigned sum = spec.luhn ? mod10_sum<2, true>(digits.data(), n) : mod10_sum<3, false>(digits.data(), n);
+    checksum_pass = (sum + spec.prefix_sum) % 10 == 0;
+    return checksum_pass;
+}
+
+CardResult validate_identifier(std::string_view input, IdType type, std::ostream *log) {
+    if (type == IdType::Iban) return validate_iban(input, log);
+    CardResult res;
+    res.issuer = id_type_name(type);
+    const bool timed = metrics_sample_card();
+
+    std::string_view normalized;
+    {
+        StageTimer timer(Stage::Normalize, timed);
+        normalized = normalize_input(input);
+    }
+    if (log) *log << "[INFO] Input normalized (spaces removed)\n";
+
+    // normalize_input() hands back a non-digit message for bad input: 0 digits
+    const bool digits = !normalized.empty() && normalized[0] >= '0' && normalized[0] <= '9';
+    {
+        StageTimer timer(Stage::Luhn, timed);
+        res.valid = digits && identifier_valid(type, normalized, res.length_pass, res.luhn_pass);
+    }
+    record_card_outcome(res.valid, false);
+
+    if (log) {
+        if (!res.length_pass) {
+            *log << "[INFO] Length check failed (" << (digits ? normalized.size() : 0) << " digits, " << res.issuer
+                 << ")\n";
+        } else {
+            *log << "[INFO] Length check passed (" << normalized.size() << " digits, " << res.issuer << ")\n";
+            *log << "[INFO] Mod-10 checksum: " << (res.luhn_pass ? "PASS" : "FAIL") << "\n";
+        }
+        *log << "[RESULT] " << res.issuer << " is " << (res.valid ? "VALID" : "INVALID") << "\n";
+    }
+    return res;
+}
@@ -0,0 +1,100 @@
+#include "numa_topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+
+/* ---------------------
+   Topology
+---------------------- */
+
+namespace {
+
+std::string read_line(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// CPUs this process may run on (a container or taskset may allow fewer than exist)
+std::vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    return cpus;
+}
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string &text) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) end = text.size();
+        const std::string range = text.substr(pos, end - pos);
+        const size_t dash = range.find('-');
+        char *rest = nullptr;
+        const long first = std::strtol(range.c_str(), &rest, 10);
+        if (rest != range.c_str()) {
+            const long last = dash == std::string::npos ? first : std::strtol(range.c_str() + dash + 1, nullptr, 10);
+            for (long cpu = first; cpu <= last; ++cpu) cpus.push_back(static_cast<int>(cpu));
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+std::string format_cpu_list(const std::vector<int> &cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!text.empty()) text += ',';
+        text += std::to_string(cpus[i]);
+        if (j > i) text += '-' + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return text;
+}
+
+std::vector<NumaNode> numa_nodes() {
+    const std::vector<int> allowed = allowed_cpus();
+    std::vector<NumaNode> nodes;
+    for (int id : parse_cpu_list(read_line("/sys/devices/system/node/online"))) {
+        NumaNode node;
+        node.id = id;
+        for (int cpu : parse_cpu_list(read_line("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist")))
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) node.cpus.push_back(cpu);
+        if (!node.cpus.empty()) nodes.push_back(std::move(node)); // Memory-only nodes run no workers
+    }
+    if (nodes.empty()) nodes.push_back(NumaNode{0, allowed});
+    return nodes;
+}
+
+/* ---------------------
+   Placement
+---------------------- */
+
+bool pin_thread_to_node(const NumaNode &node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node.cpus)
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+void bind_to_node(void *memory, size_t bytes, int node) {
+    // If the kernel refuses (no NUMA support, a seccomp filter), first touch decides
+    if (memory && node >= 0 && node < 64) {
+        const unsigned long mask = 1ul << node;
+        ::syscall(SYS_mbind, memory, bytes, MPOL_PREFERRED, &mask, 64ul, 0u);
+    }
+}
@@ -0,0 +1,489 @@
+#include "pipeline.h"
+#include "policy.h"
+#include "ring.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+
+/* ---------------------
+   Ring Bookkeeping
+---------------------- */
+
+namespace {
+
+// Live counters behind a RingStats; several workers may update the same one
+struct RingCounters {
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> occupancy_sum{0};
+    std::atomic<uint64_t> occupancy_max{0};
+    std::atomic<uint64_t> producer_waits{0};
+
+    void sample(size_t occupancy) {
+        samples.fetch_add(1, std::memory_order_relaxed);
+        occupancy_sum.fetch_add(occupancy, std::memory_order_relaxed);
+        uint64_t seen = occupancy_max.load(std::memory_order_relaxed);
+        while (occupancy > seen && !occupancy_max.compare_exchange_weak(seen, occupancy, std::memory_order_relaxed)) {
+        }
+    }
+
+    RingStats snapshot(const char *name, size_t capacity) const {
+        RingStats s;
+        s.name = name;
+        s.capacity = capacity;
+        s.samples = samples.load(std::memory_order_relaxed);
+        s.occupancy_sum = occupancy_sum.load(std::memory_order_relaxed);
+        s.occupancy_max = occupancy_max.load(std::memory_order_relaxed);
+        s.producer_waits = producer_waits.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+// Push that never gives up: wait (spin, then yield) until there is room
+template <typename Ring>
+void push_blocking(Ring &ring, RecordBatch *batch, RingCounters &counters) {
+    unsigned spins = 0;
+    if (ring.try_push(batch)) return;
+    counters.producer_waits.fetch_add(1, std::memory_order_relaxed);
+    while (!ring.try_push(batch)) ring_backoff(spins);
+}
+
+// Pop until we get a batch or the upstream stage has finished and the ring is drained
+template <typename Ring>
+bool pop_or_finish(Ring &ring, RecordBatch *&batch, const std::atomic<bool> &upstream_done,
+                   RingCounters &counters) {
+    unsigned spins = 0;
+    for (;;) {
+        if (ring.try_pop(batch)) {
+            counters.sample(ring.size() + 1); // +1: the batch we just took was on the belt too
+            return true;
+        }
+        if (upstream_done.load(std::memory_order_acquire)) {
+            // Upstream may have pushed its last batch just before raising the flag
+            if (ring.try_pop(batch)) return true;
+            return false;
+        }
+        ring_backoff(spins);
+    }
+}
+
+/* ---------------------
+   NUMA Worker Groups
+---------------------- */
+
+// One group of validation workers: a NUMA node's CPUs, its trays and its own
+// belts. Without NUMA placement there is a single group holding everything.
+struct WorkerGroup {
+    NumaNode node;
+    size_t workers = 0;
+    std::vector<std::unique_ptr<RecordBatch>> pool;   // Trays living in this node's memory
+    std::unique_ptr<MpmcRing<RecordBatch *>> input;   // reader -> this group's workers
+    std::unique_ptr<SpscRing<RecordBatch *>> free;    // writer -> reader, this group's empty trays
+    std::unique_ptr<Policy> policy;                   // Node-local copy of the active policy
+    PageMapping slab;                                 // Huge pages: every tray's first arena page
+    std::atomic<uint64_t> batches{0}, stolen{0};
+};
+
+// Spread workers over the groups in proportion to their CPUs (each gets at least one)
+void assign_workers(std::vector<WorkerGroup> &groups, size_t workers) {
+    for (size_t w = 0; w < workers; ++w) {
+        WorkerGroup *least = &groups[0];
+        for (WorkerGroup &g : groups)
+            if ((g.workers + 1) * least->node.cpus.size() < (least->workers + 1) * g.node.cpus.size()) least = &g;
+        least->workers++;
+    }
+}
+
+// Create a group's trays. With NUMA placement this runs on a thread pinned to
+// the node, so everything a tray first writes (its record and result slots,
+// its first arena page, the policy copy) is placed in that node's memory.
+// With huge pages the trays' first pages are `tray_bytes` slices of one slab,
+// faulted in up front: a handful of 2 MiB pages instead of thousands of small ones.
+void build_group(WorkerGroup &group, size_t home, size_t trays, size_t batch_size, size_t chunk_bytes,
+                 size_t tray_bytes, bool numa) {
+    group.input = std::make_unique<MpmcRing<RecordBatch *>>(trays);
+    group.free = std::make_unique<SpscRing<RecordBatch *>>(trays);
+    if (numa) pin_thread_to_node(group.node);
+    if (huge_pages_enabled()) {
+        group.slab = PageMapping(round_to_pages(trays * tray_bytes, kHugePageSize), numa ? group.node.id : -1);
+        prefault_pages(group.slab.data(), group.slab.size(), true, false);
+    }
+    for (size_t i = 0; i < trays; ++i) {
+        auto batch = std::make_unique<RecordBatch>();
+        batch->home = home;
+        if (group.slab) batch->arena.lend(group.slab.data() + i * tray_bytes, tray_bytes);
+        if (numa) {
+            batch->arena.set_node(group.node.id);
+            if (!group.slab) std::memset(batch->arena.allocate(chunk_bytes), 0, chunk_bytes);
+            batch->arena.reset();
+            // A chunk holds about 1.4 records per batch_size (24 bytes read per ~17-byte line)
+            const size_t slots = batch_size * 3 / 2;
+            batch->records.resize(slots);
+            batch->line_numbers.resize(slots);
+            batch->heads.resize(slots);
+            batch->tails.resize(slots);
+            batch->results.resize(slots);
+        }
+        group.free->try_push(batch.get());
+        group.pool.push_back(std::move(batch));
+    }
+    if (numa) group.policy = std::make_unique<Policy>(active_policy());
+}
+
+// After this many empty looks at its own belt a worker starts looking at the others'
+constexpr unsigned kStealAfterSpins = 256;
+
+// A worker's next batch: from its own group's belt if at all possible. Another
+// node's batch (remote memory) is the last resort, taken only once the own
+// belt has stayed empty for a while, or the input is finished.
+bool next_batch(std::vector<WorkerGroup> &groups, size_t home, RecordBatch *&batch,
+                const std::atomic<bool> &reader_done, RingCounters &counters) {
+    WorkerGroup &own = groups[home];
+    unsigned spins = 0;
+    for (;;) {
+        const bool done = reader_done.load(std::memory_order_acquire);
+        if (own.input->try_pop(batch)) {
+            counters.sample(own.input->size() + 1);
+            own.batches.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (done || spins >= kStealAfterSpins) {
+            for (size_t k = 1; k < groups.size(); ++k) {
+                WorkerGroup &other = groups[(home + k) % groups.size()];
+                if (other.input->try_pop(batch)) {
+                    counters.sample(other.input->size() + 1);
+                    own.batches.fetch_add(1, std::memory_order_relaxed);
+                    own.stolen.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        // The reader pushed its last batch before raising the flag, and we looked after seeing it
+        if (done) return false;
+        ring_backoff(spins);
+    }
+}
+
+// The reader's next empty tray: preferably from group `preferred` (batches are
+// dealt out in turn), else from any group, so a node that falls behind simply
+// gets fewer
+RecordBatch *take_free_batch(std::vector<WorkerGroup> &groups, size_t preferred, RingCounters &free_stats,
+                             RingCounters &input_stats) {
+    unsigned spins = 0;
+    for (bool waited = false;; waited = true) {
+        for (size_t k = 0; k < groups.size(); ++k) {
+            SpscRing<RecordBatch *> &ring = *groups[(preferred + k) % groups.size()].free;
+            RecordBatch *batch = nullptr;
+            if (ring.try_pop(batch)) {
+                free_stats.sample(ring.size() + 1);
+                return batch;
+            }
+        }
+        if (!waited) input_stats.producer_waits.fetch_add(1, std::memory_order_relaxed); // Backpressure!
+        ring_backoff(spins);
+    }
+}
+
+// One output line per card: "<line>,<result>,<issuer>,<entropy>".
+// The card number itself is deliberately NOT echoed (see the README's Safety Note).
+// With CSV/JSONL pass-through the rest of the record is kept around the result
+// instead (see ingest.h).
+// The text is written into the batch's arena: one allocation sized for the
+// worst case, then plain pointer writes.
+constexpr size_t kMaxOutputLine = 20 + 1 + 20 + 1 + 16 + 1 + 24 + 1;
+constexpr size_t kMaxRecordBytes = 1 << 20;
+constexpr size_t kJsonKeyBytes = 48; // "line":,"result":"","issuer":"","entropy":
+
+inline char *put(char *out, std::string_view text) {
+    return std::copy(text.begin(), text.end(), out);
+}
+
+void format_batch(RecordBatch &batch, const InputSpec &input) {
+    const bool passthrough = input.passthrough && input.format != InputFormat::Lines;
+    const bool json = input.format == InputFormat::Jsonl;
+    size_t bytes = batch.count * (kMaxOutputLine + kJsonKeyBytes);
+    if (passthrough)
+        for (size_t i = 0; i < batch.count; ++i) bytes += batch.heads[i].size() + batch.tails[i].size();
+
+    char *const start = batch.arena.allocate_array<char>(bytes);
+    char *out = start;
+    for (size_t i = 0; i < batch.count; ++i) {
+        const CardResult &res = batch.results[i];
+        const std::string_view label = result_label(res), issuer = res.issuer.substr(0, 16);
+        if (passthrough && json) {
+            out = put(out, batch.heads[i]);
+            out = put(out, "\"line\":");
+            out = std::to_chars(out, out + 20, batch.line_numbers[i]).ptr;
+            out = put(out, ",\"result\":\"");
+            out = put(out, label);
+            out = put(out, "\",\"issuer\":\"");
+            out = put(out, issuer);
+            out = put(out, "\",\"entropy\":");
+            out = std::to_chars(out, out + 24, res.entropy, std::chars_format::fixed, 2).ptr;
+            out = put(out, batch.tails[i]);
+        } else {
+            out = std::to_chars(out, out + 20, batch.line_numbers[i]).ptr;
+            *out++ = ',';
+            if (passthrough) out = put(out, batch.heads[i]);
+            out = put(out, label);
+            *out++ = ',';
+            out = put(out, issuer);
+            *out++ = ',';
+            out = std::to_chars(out, out + 24, res.entropy, std::chars_format::fixed, 2).ptr;
+            if (passthrough) out = put(out, batch.tails[i]);
+        }
+        *out++ = '\n';
+    }
+    batch.text = std::string_view(start, static_cast<size_t>(out - start));
+}
+
+} // namespace
+
+/* ---------------------
+   The Pipeline
+---------------------- */
+
+PipelineStats run_pipeline(std::istream &in, const PipelineOptions &options) {
+    const size_t workers = options.workers ? options.workers
+                                           : std::max(1u, std::thread::hardware_concurrency());
+    const size_t pool_size = std::max<size_t>(2, options.batches_in_flight);
+    const size_t batch_size = std::max<size_t>(1, options.batch_size);
+    const size_t chunk_bytes = batch_size * 24;
+    // A tray's input chunk (plus a carried partial record) and, with --output,
+    // the formatted lines of the ~1.5 records per batch_size a chunk holds
+    const size_t tray_bytes = round_to_pages(
+        chunk_bytes + kSmallPageSize + (options.output ? batch_size * 3 / 2 * (kMaxOutputLine + kJsonKeyBytes) : 0), 64);
+
+    // Worker groups: one per NUMA node (only as many nodes as there are workers),
+    // or a single one for everything
+    std::vector<NumaNode> nodes;
+    if (options.numa != NumaMode::Off) nodes = numa_nodes();
+    const bool numa = options.numa == NumaMode::On || (options.numa == NumaMode::Auto && nodes.size() > 1);
+    if (!numa) nodes.assign(1, NumaNode{});
+    if (nodes.size() > workers) nodes.resize(workers);
+    std::vector<WorkerGroup> groups(nodes.size());
+    for (size_t g = 0; g < groups.size(); ++g) groups[g].node = nodes[g];
+    if (numa) assign_workers(groups, workers);
+    else groups[0].workers = workers;
+
+    // The tray pool, shared out like the workers. Every ring can hold all the
+    // trays that can reach it, so the ONLY place a stage ever waits for room
+    // is the reader waiting for a free tray.
+    if (numa) {
+        std::vector<std::thread> builders;
+        for (size_t g = 0; g < groups.size(); ++g) {
+            const size_t trays = std::max<size_t>(2, pool_size * groups[g].workers / workers);
+            builders.emplace_back([&, g, trays] {
+                build_group(groups[g], g, trays, batch_size, chunk_bytes, tray_bytes, true);
+            });
+        }
+        for (std::thread &t : builders) t.join();
+    } else {
+        build_group(groups[0], 0, pool_size, batch_size, chunk_bytes, tray_bytes, false);
+    }
+    size_t total_trays = 0;
+    for (const WorkerGroup &g : groups) total_trays += g.pool.size();
+    MpmcRing<RecordBatch *> validated_ring(total_trays); // workers -> formatter
+    SpscRing<RecordBatch *> output_ring(total_trays);    // formatter -> writer
+
+    RingCounters free_stats, input_stats, validated_stats, output_stats;
+    std::atomic<bool> reader_done{false}, workers_done{false}, formatter_done{false};
+    std::atomic<size_t> workers_running{workers};
+    PipelineStats stats;
+    stats.workers = workers;
+    stats.total = options.resume.total;
+    stats.valid = options.resume.valid;
+    stats.low_confidence = options.resume.low_confidence;
+
+    // Stage 2: validation workers (the cooks), each group on its own node's CPUs
+    std::vector<std::thread> worker_threads;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        for (size_t w = 0; w < groups[g].workers; ++w) {
+            worker_threads.emplace_back([&, g] {
+                if (numa) {
+                    pin_thread_to_node(groups[g].node);
+                    set_thread_policy(groups[g].policy.get());
+                }
+                RecordBatch *batch = nullptr;
+                while (next_batch(groups, g, batch, reader_done, input_stats)) {
+                    if (batch->results.size() < batch->count) batch->results.resize(batch->count);
+                    for (size_t i = 0; i < batch->count; ++i)
+                        batch->results[i] = validate_card_quiet(batch->records[i]);
+                    push_blocking(validated_ring, batch, validated_stats);
+                }
+                // The last cook out turns off the lights
+                if (workers_running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    workers_done.store(true, std::memory_order_release);
+            });
+        }
+    }
+
+    // Stage 3: formatter (puts batches back in input order, tallies, formats)
+    std::thread formatter([&] {
+        std::map<uint64_t, RecordBatch *> waiting; // Batches that overtook an earlier one
+        uint64_t next_sequence = 0;
+        RecordBatch *batch = nullptr;
+        while (pop_or_finish(validated_ring, batch, workers_done, validated_stats)) {
+            waiting.emplace(batch->sequence, batch);
+            for (auto it = waiting.find(next_sequence); it != waiting.end(); it = waiting.find(next_sequence)) {
+                RecordBatch *ready = it->second;
+                waiting.erase(it);
+                for (size_t i = 0; i < ready->count; ++i) {
+                    const CardResult &res = ready->results[i];
+                    stats.total++;
+                    stats.valid += res.valid;
+                    stats.low_confidence += res.valid && res.low_confidence;
+                }
+                ready->progress.total = stats.total;
+                ready->progress.valid = stats.valid;
+                ready->progress.low_confidence = stats.low_confidence;
+                if (options.output) format_batch(*ready, options.input);
+                else ready->text = {};
+                push_blocking(output_ring, ready, output_stats);
+                ++next_sequence;
+            }
+        }
+        formatter_done.store(true, std::memory_order_release);
+    });
+
+    // Stage 4: writer (the waiter), who also returns empty trays to the reader
+    // Checkpoints are taken here, after a batch is fully written, so one never
+    // points past results that could still be lost.
+    uint64_t output_bytes = options.resume.output_bytes;
+    std::thread writer([&] {
+        RecordBatch *batch = nullptr;
+        while (pop_or_finish(output_ring, batch, formatter_done, output_stats)) {
+            if (options.output)
+                options.output->write(batch->text.data(), static_cast<std::streamsize>(batch->text.size()));
+            output_bytes += batch->text.size();
+            for (ResultSink *sink : options.sinks) sink->write(batch->results.data(), batch->count);
+            if (options.checkpoint && options.checkpoint->due()) {
+                if (options.output) options.output->flush();
+                batch->progress.output_bytes = output_bytes;
+                options.checkpoint->save(batch->progress);
+            }
+            push_blocking(*groups[batch->home].free, batch, free_stats);
+        }
+        if (options.output) options.output->flush();
+    });
+
+    // Stage 1: the reader runs on the calling thread (the order-taker).
+    // It reads a whole chunk of bytes straight into the batch's arena and
+    // records are just views into that chunk: no per-line strings at all.
+    // A record cut in half at the end of a chunk is carried to the next batch.
+    RecordSplitter splitter(options.input);
+    std::vector<char> carry; // Keeps its capacity, so it stops allocating after warm-up
+    uint64_t sequence = 0, line_number = options.resume.line;
+    uint64_t offset = options.resume.offset; // Input bytes consumed (complete records only)
+    uint32_t crc = options.resume.crc;
+    bool eof = false, header_written = false;
+    if (!options.csv_header.empty()) {
+        // Resuming a CSV run: learn the column layout again, but don't repeat the header row
+        RecordBatch scratch;
+        uint64_t ignored = 0;
+        splitter.split(options.csv_header.data(), options.csv_header.size(), true, scratch, ignored);
+        header_written = true;
+    }
+    RecordBatch *batch = nullptr;
+    while (!eof || !carry.empty()) {
+        if (!batch) batch = take_free_batch(groups, sequence % groups.size(), free_stats, input_stats);
+
+        // Tear off the tray's old pages in one go, then refill them
+        batch->arena.reset();
+        batch->count = 0;
+        // (A carried record that keeps growing doubles the read, so it isn't copied over and over.)
+        const size_t want = std::max(chunk_bytes, carry.size());
+        char *buf = batch->arena.allocate_array<char>(carry.size() + want);
+        size_t have = carry.size();
+        std::copy(carry.begin(), carry.end(), buf);
+        carry.clear();
+        if (!eof) {
+            in.read(buf + have, static_cast<std::streamsize>(want));
+            size_t got = static_cast<size_t>(in.gcount());
+            have += got;
+            eof = got < want;
+        }
+
+        // Only complete records are used now; the tail waits for the next chunk.
+        // (A record longer than kMaxRecordBytes is taken as-is: it holds no card number.)
+        const bool last = eof && !options.hold_partial_tail;
+        size_t complete = splitter.split(buf, have, last, *batch, line_number);
+        if (complete == 0 && batch->count == 0 && have >= kMaxRecordBytes)
+            complete = splitter.split(buf, have, true, *batch, line_number);
+        if (splitter.failed()) {
+            std::cerr << "[ERROR] " << splitter.error() << "\n";
+            stats.input_error = true;
+            break;
+        }
+        if (options.checkpoint) crc = crc32_update(crc, buf, complete);
+        offset += complete;
+        carry.assign(buf + complete, buf + have);
+        if (eof && options.hold_partial_tail) carry.clear(); // Unfinished last line: next run's job
+
+        // The CSV header row goes out before any result; the writer hasn't started yet
+        if (!header_written && options.output && !splitter.header().empty()) {
+            options.output->write(splitter.header().data(), static_cast<std::streamsize>(splitter.header().size()));
+            output_bytes += splitter.header().size(); // Before the first batch: the writer isn't counting yet
+            header_written = true;
+        }
+
+        if (batch->count == 0) continue; // Only blank lines: keep the tray and read on
+        batch->progress.offset = offset;
+        batch->progress.crc = crc;
+        batch->progress.line = line_number;
+        batch->progress.missing_field = options.resume.missing_field + splitter.missing();
+        batch->sequence = sequence++;
+        push_blocking(*groups[batch->home].input, batch, input_stats);
+        batch = nullptr;
+    }
+    reader_done.store(true, std::memory_order_release);
+
+    for (auto &t : worker_threads) t.join();
+    formatter.join();
+    writer.join();
+
+    stats.missing_field = options.resume.missing_field + splitter.missing();
+    stats.progress.offset = offset;
+    stats.progress.crc = crc;
+    stats.progress.line = line_number;
+    stats.progress.total = stats.total;
+    stats.progress.valid = stats.valid;
+    stats.progress.low_confidence = stats.low_confidence;
+    stats.progress.missing_field = stats.missing_field;
+    stats.progress.output_bytes = output_bytes;
+    size_t input_capacity = 0, free_capacity = 0;
+    for (const WorkerGroup &g : groups) {
+        for (const auto &b : g.pool) stats.arena_bytes += b->arena.bytes_reserved();
+        input_capacity += g.input->capacity();
+        free_capacity += g.free->capacity();
+        if (numa)
+            stats.numa.push_back({g.node.id, format_cpu_list(g.node.cpus), g.workers, g.batches.load(), g.stolen.load()});
+    }
+    if (huge_pages_enabled()) stats.huge_page_bytes = huge_page_bytes();
+    stats.rings.push_back(input_stats.snapshot("reader->workers", input_capacity));
+    stats.rings.push_back(validated_stats.snapshot("workers->formatter", validated_ring.capacity()));
+    stats.rings.push_back(output_stats.snapshot("formatter->writer", output_ring.capacity()));
+    stats.rings.push_back(free_stats.snapshot("writer->reader (free)", free_capacity));
+    return stats;
+}
+
+void print_pipeline_stats(std::ostream &out, const PipelineStats &stats) {
+    out << "[PIPELINE] " << stats.workers << " validation worker(s), " << stats.arena_bytes / 1024
+        << " KiB held by batch arenas\n";
+    for (const RingStats &r : stats.rings) {
+        double avg = r.samples ? double(r.occupancy_sum) / double(r.samples) : 0.0;
+        out << "[PIPELINE] " << std::left << std::setw(22) << r.name << std::right
+            << " avg occupancy " << std::fixed << std::setprecision(1) << avg << "/" << r.capacity
+            << ", max " << r.occupancy_max << ", producer waits " << r.producer_waits << "\n";
+    }
+    for (const NumaGroupStats &g : stats.numa) {
+        out << "[PIPELINE] NUMA node " << g.node << " (cpus " << g.cpus << "): " << g.workers << " worker(s), "
+            << g.batches << " batch(es), " << g.stolen << " taken from other nodes\n";
+    }
+    out.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,356 @@
+#include "policy.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* ---------------------
+   The Built-in Policy
+---------------------- */
+
+namespace {
+
+// Exactly what the validator always did: 13-19 digits, Luhn decides validity,
+// weak entropy or a repeated pattern makes a valid card "low confidence"
+constexpr std::string_view kDefaultPolicy =
+    "entropy_threshold 3.5\n"
+    "rule not length 13..19 -> invalid\n"
+    "rule luhn fail -> invalid\n"
+    "rule entropy < 3.5 -> low_confidence\n"
+    "rule repetition fail -> low_confidence\n"
+    "default valid\n";
+
+// Beyond this the (issuer, length, facts) table is skipped and rules are scanned
+constexpr size_t kMaxTableBytes = 64 * 1024;
+
+constexpr uint32_t kAllLengths = ~uint32_t(1); // Every length except 0 (empty input)
+constexpr uint32_t kAllIssuers = (1u << static_cast<uint32_t>(Issuer::Count)) - 1;
+
+Policy g_active_policy;
+
+/* ---------------------
+   Parsing Helpers
+---------------------- */
+
+// Split a line into words, dropping a "# comment" tail
+std::vector<std::string_view> split_words(std::string_view line) {
+    if (size_t hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+    std::vector<std::string_view> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+        size_t start = i;
+        while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+        if (i > start) words.push_back(line.substr(start, i - start));
+    }
+    return words;
+}
+
+bool parse_uint(std::string_view text, uint64_t &value) {
+    if (text.empty() || text.size() > 19) return false;
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + uint64_t(c - '0');
+    }
+    return true;
+}
+
+bool parse_double(std::string_view text, double &value) {
+    std::string copy(text);
+    char *end = nullptr;
+    value = std::strtod(copy.c_str(), &end);
+    return !copy.empty() && end == copy.c_str() + copy.size() && std::isfinite(value);
+}
+
+// "13..19", "15" or "13,16,19" (or a mix: "12..14,16") -> one bit per length
+bool parse_lengths(std::string_view text, uint32_t &mask) {
+    mask = 0;
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+        uint64_t lo = 0, hi = 0;
+        if (size_t dots = item.find(".."); dots != std::string_view::npos) {
+            if (!parse_uint(item.substr(0, dots), lo) || !parse_uint(item.substr(dots + 2), hi)) return false;
+        } else if (!parse_uint(item, lo)) {
+            return false;
+        } else {
+            hi = lo;
+        }
+        if (lo < 1 || hi > kMaxPolicyLength || lo > hi) return false;
+        for (uint64_t l = lo; l <= hi; ++l) mask |= 1u << l;
+    }
+    return mask != 0;
+}
+
+// "VISA" or "VISA,MASTERCARD" -> one bit per Issuer
+bool parse_issuers(std::string_view text, uint32_t &mask) {
+    mask = 0;
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view name = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+        Issuer issuer = issuer_from_name(name);
+        if (issuer == Issuer::Unknown && name != "UNKNOWN") return false;
+        mask |= 1u << static_cast<uint32_t>(issuer);
+    }
+    return mask != 0;
+}
+
+bool parse_verdict(std::string_view text, Verdict &verdict) {
+    if (text == "valid") verdict = Verdict::Valid;
+    else if (text == "low_confidence") verdict = Verdict::LowConfidence;
+    else if (text == "invalid") verdict = Verdict::Invalid;
+    else return false;
+    return true;
+}
+
+bool parse_pass_fail(std::string_view text, bool &pass) {
+    if (text == "pass") pass = true;
+    else if (text == "fail") pass = false;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+/* ---------------------
+   Compiling a Policy
+---------------------- */
+
+Policy::Policy() {
+    std::string error;
+    compile(kDefaultPolicy, error); // Can't fail: it is our own text
+}
+
+bool Policy::compile(std::string_view text, std::string &error) {
+    Policy next{EmptyTag{}}; // Built on the side, so a bad file leaves *this untouched
+    bool have_default = false;
+
+    next.fingerprint_ = 14695981039346656037ull; // FNV-1a
+    for (char c : text) next.fingerprint_ = (next.fingerprint_ ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+
+    // Entropy thresholds become fact bits; the same number twice shares a bit
+    auto entropy_bit = [&](double cut, uint32_t &bit) {
+        for (size_t i = 0; i < next.cut_count_; ++i)
+            if (next.cuts_[i] == cut) { bit = 1u << (kFactEntropyBelow + i); return true; }
+        if (next.cut_count_ == kMaxEntropyCuts) return false;
+        next.cuts_[next.cut_count_] = cut;
+        bit = 1u << (kFactEntropyBelow + next.cut_count_++);
+        return true;
+    };
+
+    size_t line_number = 0;
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view{} : text.substr(eol + 1);
+        ++line_number;
+
+        std::vector<std::string_view> words = split_words(line);
+        if (words.empty()) continue;
+        auto fail = [&](const std::string &why) {
+            error = "line " + std::to_string(line_number) + ": " + why;
+            return false;
+        };
+
+        if (words[0] == "entropy_threshold") {
+            if (words.size() != 2 || !parse_double(words[1], next.entropy_threshold_))
+                return fail("expected 'entropy_threshold <bits>'");
+        } else if (words[0] == "block") {
+            if (words.size() < 2) return fail("expected 'block <prefix> [<prefix>...]'");
+            for (size_t i = 1; i < words.size(); ++i) {
+                uint64_t prefix = 0;
+                if (!parse_uint(words[i], prefix)) return fail("bad block prefix '" + std::string(words[i]) + "'");
+                next.blocklist_[words[i].size()].push_back(prefix);
+                next.has_blocklist_ = true;
+            }
+        } else if (words[0] == "default") {
+            if (words.size() != 2 || !parse_verdict(words[1], next.default_))
+                return fail("expected 'default valid|low_confidence|invalid'");
+            have_default = true;
+        } else if (words[0] == "rule") {
+            if (have_default) return fail("rule after 'default' can never match");
+            PolicyRule rule{kAllLengths, kAllIssuers, 0, 0, Verdict::Invalid};
+
+            size_t i = 1;
+            for (;;) {
+                if (i >= words.size()) return fail("expected '-> <verdict>'");
+                bool negate = false;
+                if (words[i] == "not") { negate = true; ++i; }
+                if (i >= words.size()) return fail("expected a condition after 'not'");
+
+                std::string_view what = words[i++];
+                auto argument = [&]() -> std::string_view { return i < words.size() ? words[i++] : std::string_view{}; };
+
+                if (what == "length" || what == "issuer") {
+                    uint32_t mask = 0;
+                    std::string_view arg = argument();
+                    if (what == "length") {
+                        if (!parse_lengths(arg, mask)) return fail("bad length list '" + std::string(arg) + "'");
+                        rule.lengths &= negate ? (kAllLengths & ~mask) : mask;
+                    } else {
+                        if (!parse_issuers(arg, mask)) return fail("bad issuer list '" + std::string(arg) + "'");
+                        rule.issuers &= negate ? (kAllIssuers & ~mask) : mask;
+                    }
+                } else if (what == "luhn" || what == "repetition") {
+                    bool pass = false;
+                    if (!parse_pass_fail(argument(), pass)) return fail("expected '" + std::string(what) + " pass|fail'");
+                    uint32_t bit = what == "luhn" ? kFactLuhn : kFactRepetition;
+                    rule.care |= bit;
+                    rule.want = (pass != negate) ? (rule.want | bit) : (rule.want & ~bit);
+                } else if (what == "blocked") {
+                    rule.care |= kFactBlocked;
+                    rule.want = negate ? (rule.want & ~kFactBlocked) : (rule.want | kFactBlocked);
+                } else if (what == "entropy") {
+                    // Every comparison is phrased as "entropy < cut" (set) or not (clear)
+                    std::string_view op = argument();
+                    double value = 0;
+                    if (!parse_double(argument(), value)) return fail("expected 'entropy <|<=|>|>= <bits>'");
+                    bool below = false;
+                    if (op == "<") below = true;
+                    else if (op == ">=") below = false;
+                    else if (op == "<=") { below = true; value = std::nextafter(value, INFINITY); }
+                    else if (op == ">") { below = false; value = std::nextafter(value, INFINITY); }
+                    else return fail("unknown entropy comparison '" + std::string(op) + "'");
+
+                    uint32_t bit = 0;
+                    if (!entropy_bit(value, bit)) return fail("too many distinct entropy thresholds");
+                    rule.care |= bit;
+                    rule.want = (below != negate) ? (rule.want | bit) : (rule.want & ~bit);
+                } else {
+                    return fail("unknown condition '" + std::string(what) + "'");
+                }
+
+                if (i < words.size() && words[i] == "and") { ++i; continue; }
+                if (i + 2 == words.size() && words[i] == "->" && parse_verdict(words[i + 1], rule.verdict)) break;
+                return fail("expected 'and <condition>' or '-> valid|low_confidence|invalid'");
+            }
+            // "issuer X" tested twice with different values can never match; harmless, keep it
+            next.rules_.push_back(rule);
+        } else {
+            return fail("unknown statement '" + std::string(words[0]) + "'");
+        }
+    }
+
+    for (auto &prefixes : next.blocklist_) {
+        std::sort(prefixes.begin(), prefixes.end());
+        prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+    }
+    next.fact_bits_ = kFactEntropyBelow + next.cut_count_;
+    next.build_table();
+    *this = std::move(next);
+    error.clear();
+    return true;
+}
+
+// Work out every (issuer, length, facts) answer once, up front. The same pass
+// finds which lengths can ever be anything but INVALID, so the validator can
+// turn those away before touching a single digit.
+void Policy::build_table() {
+    const size_t issuers = static_cast<size_t>(Issuer::Count);
+    const size_t combos = size_t(1) << fact_bits_;
+    const size_t bytes = issuers * (kMaxPolicyLength + 1) * combos;
+
+    table_.clear();
+    live_lengths_ = 0;
+    if (bytes <= kMaxTableBytes) {
+        table_.resize(bytes);
+        for (size_t issuer = 0; issuer < issuers; ++issuer)
+            for (size_t length = 0; length <= kMaxPolicyLength; ++length)
+                for (size_t facts = 0; facts < combos; ++facts) {
+                    Verdict v = length == 0 ? Verdict::Invalid
+                                            : scan(length, static_cast<Issuer>(issuer), uint32_t(facts));
+                    table_[((issuer * (kMaxPolicyLength + 1) + length) << fact_bits_) | facts] = uint8_t(v);
+                    if (v != Verdict::Invalid) live_lengths_ |= 1u << length;
+                }
+        return;
+    }
+
+    // Too many fact combinations to tabulate: be conservative. A length is live
+    // if some non-invalid rule (or the default) could reach it.
+    uint32_t dead = 0; // Lengths an unconditional "-> invalid" rule has already claimed
+    for (const PolicyRule &rule : rules_) {
+        if (rule.verdict != Verdict::Invalid) live_lengths_ |= rule.lengths & ~dead;
+        else if (rule.care == 0 && rule.issuers == kAllIssuers) dead |= rule.lengths;
+    }
+    if (default_ != Verdict::Invalid) live_lengths_ |= kAllLengths & ~dead;
+}
+
+Verdict Policy::scan(size_t length, Issuer issuer, uint32_t facts) const {
+    const uint32_t length_bit = length <= kMaxPolicyLength ? 1u << length : 0;
+    const uint32_t issuer_bit = 1u << static_cast<uint32_t>(issuer);
+    for (const PolicyRule &rule : rules_)
+        if ((rule.lengths & length_bit) && (rule.issuers & issuer_bit) && (facts & rule.care) == rule.want)
+            return rule.verdict;
+    return default_;
+}
+
+bool Policy::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[ERROR] Cannot open policy file " << path << "\n";
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string error;
+    if (!compile(text.str(), error)) {
+        std::cerr << "[ERROR] Policy " << path << ", " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+/* ---------------------
+   The Blocklist
+---------------------- */
+
+// Prefixes are stored as numbers, grouped by how many digits they have. The
+// card's leading digits are turned into a number one digit at a time, and at
+// each prefix length that has entries we binary-search that group: a few
+// integer compares, never a string compare.
+bool Policy::blocked(std::string_view digits) const {
+    uint64_t value = 0;
+    const size_t limit = std::min(digits.size(), blocklist_.size() - 1);
+    for (size_t length = 1; length <= limit; ++length) {
+        value = value * 10 + uint64_t(digits[length - 1] - '0');
+        const LargePageVector<uint64_t> &group = blocklist_[length];
+        if (!group.empty() && std::binary_search(group.begin(), group.end(), value)) return true;
+    }
+    return false;
+}
+
+size_t Policy::blocklist_size() const {
+    size_t n = 0;
+    for (const auto &group : blocklist_) n += group.size();
+    return n;
+}
+
+bool Policy::prefault_tables(bool lock) const {
+    // Read-only: the pages are only faulted in (and pinned), never written
+    bool locked = prefault_pages(const_cast<uint8_t *>(table_.data()), table_.size(), false, lock);
+    for (const auto &group : blocklist_)
+        locked &= prefault_pages(const_cast<uint64_t *>(group.data()), group.size() * sizeof(uint64_t), false, lock);
+    return locked;
+}
+
+/* ---------------------
+   The Active Policy
+---------------------- */
+
+namespace {
+thread_local const Policy *t_policy_replica = nullptr;
+}
+
+const Policy &active_policy() { return t_policy_replica ? *t_policy_replica : g_active_policy; }
+
+void set_thread_policy(const Policy *replica) { t_policy_replica = replica; }
+
+void set_active_policy(const Policy &policy) { g_active_policy = policy; }
@@ -0,0 +1,300 @@
+#include "profiler.h"
+#include "digit_scan.h"
+#include "metrics.h"
+#include "policy.h"
+#include "validator.h"
+#include <array>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* ---------------------
+   Counter Group
+---------------------- */
+
+namespace {
+
+struct EventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+// Which dial on the CPU's dashboard each PerfEvent reads
+constexpr std::array<EventSpec, kPerfEventCount> kEventSpecs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+}};
+
+constexpr std::array<const char *, kPerfEventCount> kEventNames = {
+    "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses", "dTLB-misses"};
+
+// glibc has no wrapper for perf_event_open, so we make the raw syscall
+int open_event(const EventSpec &spec, int group_fd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group_fd < 0 ? 1 : 0; // Only the leader starts disabled
+    attr.exclude_kernel = 1;              // User-space only: works at perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+} // namespace
+
+PerfCounterGroup::PerfCounterGroup() {
+    int leader = -1;
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        fds_[i] = open_event(kEventSpecs[i], leader);
+        ids_[i] = 0;
+        if (fds_[i] < 0) continue; // Not supported here: this column reads "n/a"
+        if (leader < 0) leader = fds_[i];
+        ::ioctl(fds_[i], PERF_EVENT_IOC_ID, &ids_[i]);
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : fds_)
+        if (fd >= 0) ::close(fd);
+}
+
+bool PerfCounterGroup::any_available() const {
+    for (int fd : fds_)
+        if (fd >= 0) return true;
+    return false;
+}
+
+// The first fd that opened is the group leader; ioctls on it drive the whole group
+static int leader_fd(const int *fds) {
+    for (size_t i = 0; i < kPerfEventCount; ++i)
+        if (fds[i] >= 0) return fds[i];
+    return -1;
+}
+
+void PerfCounterGroup::start() {
+    int leader = leader_fd(fds_);
+    if (leader >= 0) {
+        ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    tsc_start_ = read_cycles();
+}
+
+std::vector<uint64_t> PerfCounterGroup::stop() {
+    uint64_t tsc_end = read_cycles();
+    std::vector<uint64_t> counts(kPerfEventCount, 0);
+
+    int leader = leader_fd(fds_);
+    if (leader >= 0) {
+        ::ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // Group read layout: { nr, { value, id } x nr }
+        uint64_t buf[1 + 2 * kPerfEventCount] = {};
+        if (::read(leader, buf, sizeof(buf)) > 0) {
+            for (uint64_t n = 0; n < buf[0] && n < kPerfEventCount; ++n) {
+                for (size_t i = 0; i < kPerfEventCount; ++i)
+                    if (fds_[i] >= 0 && ids_[i] == buf[2 + 2 * n]) counts[i] = buf[1 + 2 * n];
+            }
+        }
+    }
+
+    if (!available(PerfEvent::Cycles)) counts[static_cast<size_t>(PerfEvent::Cycles)] = tsc_end - tsc_start_;
+    return counts;
+}
+
+InheritedCounter::InheritedCounter(PerfEvent event) {
+    const EventSpec &spec = kEventSpecs[static_cast<size_t>(event)];
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.inherit = 1; // Threads started later count too (no group reads with inherit)
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+InheritedCounter::~InheritedCounter() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+uint64_t InheritedCounter::read() const {
+    uint64_t value = 0;
+    if (fd_ < 0 || ::read(fd_, &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
+
+/* ---------------------
+   Staged Profile Run
+---------------------- */
+
+namespace {
+
+// Accumulated counter totals for one (stage, length) cell of the report
+struct ProfileCell {
+    uint64_t cards = 0;
+    std::array<uint64_t, kPerfEventCount> counts{};
+};
+
+// Results are folded into this so the optimizer can't delete a "useless" stage
+volatile uint64_t g_sink = 0;
+
+template <typename Fn>
+void measure(PerfCounterGroup &group, ProfileCell &cell, size_t cards, Fn &&stage_pass) {
+    group.start();
+    stage_pass();
+    std::vector<uint64_t> counts = group.stop();
+    cell.cards += cards;
+    for (size_t i = 0; i < kPerfEventCount; ++i) cell.counts[i] += counts[i];
+}
+
+void print_row(std::ostream &out, const PerfCounterGroup &group, const char *stage,
+               const std::string &length, const ProfileCell &cell) {
+    auto per_card = [&](PerfEvent e) -> std::string {
+        if (e != PerfEvent::Cycles && !group.available(e)) return "n/a";
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(2)
+          << double(cell.counts[static_cast<size_t>(e)]) / double(cell.cards);
+        return s.str();
+    };
+    auto ratio = [&](PerfEvent num, PerfEvent den) -> std::string {
+        uint64_t d = cell.counts[static_cast<size_t>(den)];
+        if (!group.available(num) || !group.available(den) || d == 0) return "n/a";
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(2) << double(cell.counts[static_cast<size_t>(num)]) / double(d);
+        return s.str();
+    };
+
+    out << "[PROFILE] " << std::left << std::setw(11) << stage << std::right
+        << std::setw(4) << length << std::setw(10) << cell.cards
+        << std::setw(12) << per_card(PerfEvent::Cycles)
+        << std::setw(12) << per_card(PerfEvent::Instructions)
+        << std::setw(7) << ratio(PerfEvent::Instructions, PerfEvent::Cycles)
+        << std::setw(11) << per_card(PerfEvent::BranchMisses)
+        << std::setw(11) << per_card(PerfEvent::L1DMisses)
+        << std::setw(11) << per_card(PerfEvent::LLCMisses)
+        << std::setw(11) << per_card(PerfEvent::DTLBMisses) << "\n";
+}
+
+} // namespace
+
+int run_profile(const std::vector<std::string> &cards, std::ostream &out) {
+    PerfCounterGroup group;
+    if (!group.any_available()) {
+        out << "[INFO] Hardware counters unavailable (perf_event_open refused); "
+               "reporting rdtsc cycles only\n";
+    } else {
+        for (size_t i = 0; i < kPerfEventCount; ++i)
+            if (!group.available(static_cast<PerfEvent>(i)))
+                out << "[INFO] Counter " << kEventNames[i] << " unavailable on this machine; column shows n/a\n";
+    }
+
+    // Normalize first, then sort the cards into bins by their digit count
+    std::map<size_t, std::vector<std::string>> by_length;
+    std::map<size_t, std::vector<size_t>> raw_by_length;
+    for (size_t i = 0; i < cards.size(); ++i) {
+        std::string_view n = normalize_input(cards[i]);
+        raw_by_length[n.size()].push_back(i);
+        by_length[n.size()].emplace_back(n);
+    }
+
+    // report[stage][length] -> counter totals for that cell
+    std::array<std::map<size_t, ProfileCell>, kStageCount> report;
+
+    for (auto &[len, numbers] : by_length) {
+        const std::vector<size_t> &raw = raw_by_length[len];
+        const size_t n = numbers.size();
+
+        auto run = [&](Stage stage, auto &&pass) {
+            ProfileCell &cell = report[static_cast<size_t>(stage)][len];
+            measure(group, cell, n, pass);
+        };
+
+        // Each stage is its own tight pass over this length bin
+        run(Stage::Normalize, [&] {
+            uint64_t acc = 0;
+            for (size_t i : raw) acc += normalize_input(cards[i]).size();
+            g_sink = g_sink + acc;
+        });
+        run(Stage::Length, [&] {
+            uint64_t acc = 0;
+            for (const auto &s : numbers) acc += issuer_rule(detect_issuer_id(s)).allows(s.size());
+            g_sink = g_sink + acc;
+        });
+        const Policy &policy = active_policy();
+        const bool digits = !numbers.empty() && isdigit(static_cast<unsigned char>(numbers[0][0]));
+        if (!digits || !policy.length_live(len)) continue; // The real validator stops here too
+
+        run(Stage::Issuer, [&] {
+            uint64_t acc = 0;
+            for (const auto &s : numbers) acc += detect_issuer(s).size();
+            g_sink = g_sink + acc;
+        });
+        run(Stage::Luhn, [&] {
+            uint64_t acc = 0;
+            for (const auto &s : numbers) acc += luhn_check(s);
+            g_sink = g_sink + acc;
+        });
+        run(Stage::Entropy, [&] {
+            double acc = 0;
+            for (const auto &s : numbers) acc += calculate_entropy(s);
+            g_sink = g_sink + static_cast<uint64_t>(acc);
+        });
+        run(Stage::Repetition, [&] {
+            uint64_t acc = 0;
+            for (const auto &s : numbers) acc += repetition_check_optimized(s);
+            g_sink = g_sink + acc;
+        });
+        // The fused kernel does the five passes above in one, straight from the raw input
+        // (numbers too long for it take the staged passes in the validator as well)
+        if (len <= kMaxScanDigits) run(Stage::Scan, [&] {
+            double acc = 0;
+            for (size_t i : raw) {
+                const DigitScan scan = scan_digits(cards[i]);
+                acc += double(issuer_from_prefix(scan.prefix)) + (scan.luhn_sum % 10 == 0) + scan_entropy(scan) +
+                       (scan.repeat == 0);
+            }
+            g_sink = g_sink + static_cast<uint64_t>(acc);
+        });
+
+        // The policy pass only decides: the check results it combines are worked out beforehand
+        struct Checked { Issuer issuer; bool luhn, repetition; double entropy; };
+        std::vector<Checked> checked;
+        checked.reserve(n);
+        for (const auto &s : numbers)
+            checked.push_back({detect_issuer_id(s), luhn_check(s), repetition_check_optimized(s), calculate_entropy(s)});
+        run(Stage::Policy, [&] {
+            uint64_t acc = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const Checked &c = checked[i];
+                acc += uint64_t(policy.decide(len, c.issuer, policy.facts(c.luhn, c.repetition, c.entropy, numbers[i])));
+            }
+            g_sink = g_sink + acc;
+        });
+    }
+
+    out << "[PROFILE] stage       len     cards cycles/card  instr/card    IPC br-miss/cd  L1D-mis/cd  LLC-mis/cd  dTLB/card\n";
+    for (size_t s = 0; s < kStageCount; ++s) {
+        const char *name = stage_name(static_cast<Stage>(s));
+        ProfileCell total;
+        for (const auto &[len, cell] : report[s]) {
+            print_row(out, group, name, std::to_string(len), cell);
+            total.cards += cell.cards;
+            for (size_t i = 0; i < kPerfEventCount; ++i) total.counts[i] += cell.counts[i];
+        }
+        if (total.cards) print_row(out, group, name, "all", total);
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include "segment_log.h"
+#include "huge_pages.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+/* ---------------------
+   Layout
+---------------------- */
+
+namespace {
+
+constexpr size_t kWriteBufferBytes = 1 << 20; // append() flushes on its own past this
+
+// Segment files of a partition, sorted by base offset (the zero-padded names sort the same way)
+std::vector<std::string> list_segments(const std::string &dir) {
+    std::vector<std::string> segments;
+    std::error_code ec;
+    for (const fs::directory_entry &entry : fs::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() == 24 && name.ends_with(".log")) segments.push_back(entry.path().string());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+uint64_t segment_base(const std::string &path) {
+    return std::strtoull(fs::path(path).filename().string().c_str(), nullptr, 10);
+}
+
+std::string segment_name(const std::string &dir, uint64_t base) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu.log", static_cast<unsigned long long>(base));
+    return dir + "/" + name;
+}
+
+// The record starting at data[pos], if all of it is there (a crash can leave
+// a torn one at the end of the last segment)
+bool read_record(const char *data, size_t size, size_t pos, LogRecord &rec, size_t &next) {
+    if (size - pos < kLogRecordHeader) return false;
+    uint32_t length;
+    std::memcpy(&rec.offset, data + pos, 8);
+    std::memcpy(&length, data + pos + 8, 4);
+    if (size - pos - kLogRecordHeader < length) return false;
+    rec.payload = std::string_view(data + pos + kLogRecordHeader, length);
+    next = pos + kLogRecordHeader + length;
+    return true;
+}
+
+} // namespace
+
+std::string partition_dir(const std::string &log, uint32_t partition) {
+    return log + "/partition-" + std::to_string(partition);
+}
+
+uint32_t count_partitions(const std::string &log) {
+    uint32_t n = 0;
+    while (fs::is_directory(partition_dir(log, n))) ++n;
+    return n;
+}
+
+/* ---------------------
+   Reader
+---------------------- */
+
+PartitionReader::~PartitionReader() { unmap(); }
+
+void PartitionReader::unmap() {
+    if (data_) ::munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = pos_ = 0;
+}
+
+bool PartitionReader::map_segment(size_t index) {
+    unmap();
+    segment_ = index;
+    const int fd = ::open(segments_[index].c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st{};
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        std::cerr << "[ERROR] Could not open log segment " << segments_[index] << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void *map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            std::cerr << "[ERROR] Could not map log segment " << segments_[index] << "\n";
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        ::madvise(map, size_, MADV_SEQUENTIAL); // Read-ahead, and drop pages behind us
+        advise_huge_mapping(map, size_);
+        data_ = static_cast<const char *>(map);
+    }
+    ::close(fd);
+    return true;
+}
+
+bool PartitionReader::open(const std::string &dir, uint64_t first_offset) {
+    segments_ = list_segments(dir);
+    next_offset_ = first_offset;
+    if (segments_.empty()) return true;
+
+    // The last segment starting at or before first_offset holds it
+    size_t index = 0;
+    while (index + 1 < segments_.size() && segment_base(segments_[index + 1]) <= first_offset) ++index;
+    if (!map_segment(index)) return false;
+
+    // Step over the records before it
+    LogRecord rec;
+    size_t next;
+    while (read_record(data_, size_, pos_, rec, next) && rec.offset < first_offset) pos_ = next;
+    return true;
+}
+
+size_t PartitionReader::next(LogRecord *out, size_t max) {
+    for (;;) {
+        size_t n = 0, next;
+        while (n < max && read_record(data_, size_, pos_, out[n], next)) {
+            pos_ = next;
+            next_offset_ = out[n++].offset + 1;
+        }
+        if (n > 0) return n;
+        if (segments_.empty() || segment_ + 1 >= segments_.size()) return 0;
+        if (!map_segment(segment_ + 1)) return 0;
+    }
+}
+
+/* ---------------------
+   Writer
+---------------------- */
+
+PartitionWriter::~PartitionWriter() {
+    flush();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool PartitionWriter::open(const std::string &dir, uint64_t truncate_to, uint64_t segment_bytes) {
+    dir_ = dir;
+    segment_bytes_ = segment_bytes;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    std::vector<std::string> segments = list_segments(dir);
+    if (segments.empty()) {
+        if (truncate_to != kNoTruncate && truncate_to > 0) {
+            std::cerr << "[ERROR] " << dir << " is empty but " << truncate_to << " records were committed to it\n";
+            return false;
+        }
+        next_offset_ = 0;
+        return start_segment();
+    }
+
+    // Cutting back: segments that start past the cut go entirely
+    size_t last = segments.size() - 1;
+    if (truncate_to != kNoTruncate) {
+        while (last > 0 && segment_base(segments[last]) > truncate_to) fs::remove(segments[last--], ec);
+    }
+
+    // Walk the last segment to its end (or to the cut), then chop off the rest
+    const std::string &path = segments[last];
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    next_offset_ = segment_base(path);
+    size_t pos = 0, next;
+    LogRecord rec;
+    while (read_record(data.data(), data.size(), pos, rec, next) && rec.offset < truncate_to) {
+        pos = next;
+        next_offset_ = rec.offset + 1;
+    }
+    if (truncate_to != kNoTruncate && next_offset_ < truncate_to) {
+        std::cerr << "[ERROR] " << dir << " ends at record " << next_offset_ << " but " << truncate_to
+                  << " records were committed to it\n";
+        return false;
+    }
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd_ < 0 || ::ftruncate(fd_, static_cast<off_t>(pos)) != 0 || ::lseek(fd_, 0, SEEK_END) < 0) {
+        std::cerr << "[ERROR] Could not open log segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    segment_size_ = pos;
+    return true;
+}
+
+bool PartitionWriter::start_segment() {
+    if (fd_ >= 0) ::close(fd_);
+    const std::string path = segment_name(dir_, next_offset_);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[ERROR] Could not create log segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    segment_size_ = 0;
+    return true;
+}
+
+bool PartitionWriter::append(std::string_view payload) {
+    const size_t bytes = kLogRecordHeader + payload.size();
+    // A segment ends on a record boundary once it's full: flush what belongs to it, start the next
+    if (segment_size_ + pending_.size() > 0 && segment_size_ + pending_.size() + bytes > segment_bytes_) {
+        if (!flush() || !start_segment()) return false;
+    }
+    const uint32_t length = static_cast<uint32_t>(payload.size());
+    const size_t at = pending_.size();
+    pending_.resize(at + bytes);
+    std::memcpy(pending_.data() + at, &next_offset_, 8);
+    std::memcpy(pending_.data() + at + 8, &length, 4);
+    std::memcpy(pending_.data() + at + kLogRecordHeader, payload.data(), payload.size());
+    ++next_offset_;
+    return pending_.size() < kWriteBufferBytes || flush();
+}
+
+bool PartitionWriter::flush() {
+    size_t done = 0;
+    while (done < pending_.size() && fd_ >= 0) {
+        const ssize_t n = ::write(fd_, pending_.data() + done, pending_.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "[ERROR] Could not write to " << dir_ << ": " << std::strerror(errno) << "\n";
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    // What reached the file is gone from the buffer either way, so a later flush never writes it twice
+    segment_size_ += done;
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(done));
+    return pending_.empty() && fd_ >= 0;
+}
+
+/* ---------------------
+   Committed Offsets
+---------------------- */
+
+bool load_offsets(const std::string &path, std::vector<CommittedOffset> &offsets) {
+    offsets.clear();
+    std::ifstream file(path);
+    if (!file) return true; // Nothing committed yet
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        uint32_t partition;
+        CommittedOffset committed;
+        if (!(fields >> partition >> committed.input >> committed.output)) {
+            std::cerr << "[ERROR] Malformed offsets file " << path << ": '" << line << "'\n";
+            return false;
+        }
+        if (partition >= offsets.size()) offsets.resize(partition + 1);
+        offsets[partition] = committed;
+    }
+    return true;
+}
+
+bool save_offsets(const std::string &path, const std::vector<CommittedOffset> &offsets) {
+    // Same trick as the checkpoint file: a crash mid-write keeps the old commit
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        file << "# cardguard offsets v1: partition next_input_offset output_offset\n";
+        for (size_t p = 0; p < offsets.size(); ++p)
+            file << p << " " << offsets[p].input << " " << offsets[p].output << "\n";
+        file.flush();
+        if (!file) {
+            std::cerr << "[ERROR] Could not write offsets file " << tmp << "\n";
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "[ERROR] Could not replace offsets file " << path << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#include "shm_client.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+/* ---------------------
+   Round-trip Benchmark
+---------------------- */
+
+// Times submit -> answer for one outstanding batch at a time, for a few batch
+// sizes. Every slot is filled once up front (the zero-copy path: the client
+// writes straight into shared memory), so the loop measures the channel and
+// the validation, not our own memcpy.
+int run_shm_benchmark(const std::string &name) {
+    ShmClient client;
+    if (!client.open(name)) return 1;
+
+    const std::string_view card = "4539148803436467";
+    const uint32_t batch_sizes[] = {1, 16, kShmMaxBatch};
+    const int rounds = 20000;
+
+    for (uint32_t batch : batch_sizes) {
+        // Fill every pigeonhole once with `batch` copies of the test card
+        for (uint32_t s = 0; s < kShmSlots; ++s) {
+            ShmRequestSlot *slot = client.begin_request();
+            for (uint32_t i = 0; i < batch; ++i) {
+                slot->offsets[i] = static_cast<uint32_t>(i * card.size());
+                std::memcpy(slot->bytes + i * card.size(), card.data(), card.size());
+            }
+            slot->offsets[batch] = static_cast<uint32_t>(batch * card.size());
+            slot->count = batch;
+            uint32_t ticket = client.submit();
+            if (!client.wait(ticket)) return 1;
+            client.release(ticket);
+        }
+
+        std::vector<uint64_t> ns(rounds);
+        for (int r = 0; r < rounds; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            client.begin_request();
+            uint32_t ticket = client.submit();
+            const ShmResponseSlot *answer = client.wait(ticket);
+            auto t1 = std::chrono::steady_clock::now();
+            if (!answer) {
+                std::cerr << "[ERROR] Server closed the channel mid-benchmark\n";
+                return 1;
+            }
+            client.release(ticket);
+            ns[r] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        }
+
+        std::sort(ns.begin(), ns.end());
+        uint64_t sum = 0;
+        for (uint64_t v : ns) sum += v;
+        std::cout << "[BENCH] shm round trip, batch " << batch << ": p50 " << ns[rounds / 2] << " ns, p99 "
+                  << ns[rounds * 99 / 100] << " ns, mean " << sum / rounds << " ns ("
+                  << (sum / rounds) / batch << " ns/card)\n";
+    }
+    return 0;
+}
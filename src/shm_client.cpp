@@ -0,0 +1,129 @@
+#include "shm_client.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+ShmClient::~ShmClient() {
+    close();
+}
+
+bool ShmClient::open(const std::string &name) {
+    close();
+    const std::string path = name.empty() || name[0] != '/' ? "/" + name : name;
+    int fd = ::shm_open(path.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "[ERROR] No shared memory channel " << path << " (is the server running?)\n";
+        return false;
+    }
+    void *base = ::mmap(nullptr, kShmMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map shared memory channel " << path << "\n";
+        return false;
+    }
+
+    ShmChannel *channel = static_cast<ShmChannel *>(base);
+    if (channel->magic.load(std::memory_order_acquire) != kShmMagic || channel->version != kShmVersion ||
+        channel->slots != kShmSlots || channel->max_batch != kShmMaxBatch) {
+        std::cerr << "[ERROR] " << path << " is not a compatible CardGuard channel\n";
+        ::munmap(base, kShmMappingSize);
+        return false;
+    }
+    // The channel belongs to whichever pid is stored in it. A client that
+    // crashed never clears its pid, so a holder that no longer exists is
+    // replaced rather than locking the channel until the server restarts.
+    const uint32_t pid = static_cast<uint32_t>(::getpid());
+    uint32_t holder = 0;
+    bool taken_over = false;
+    while (!channel->client_pid.compare_exchange_strong(holder, pid, std::memory_order_acq_rel)) {
+        if (::kill(static_cast<pid_t>(holder), 0) == 0 || errno != ESRCH) {
+            std::cerr << "[ERROR] Shared memory channel " << path << " already has a client (pid " << holder
+                      << ")\n";
+            ::munmap(base, kShmMappingSize);
+            return false;
+        }
+        taken_over = true;
+    }
+
+    // A client that died may have left requests in flight: let the server
+    // answer them all before their slots are reused
+    if (taken_over) {
+        std::cerr << "[INFO] Took over shared memory channel " << path << " from pid " << holder
+                  << ", which has exited\n";
+        const uint32_t submitted = channel->request_tail.load(std::memory_order_acquire);
+        uint32_t answered = channel->response_tail.load(std::memory_order_acquire);
+        while (answered != submitted && !channel->shutdown.load(std::memory_order_relaxed))
+            answered = shm_wait_for_change(channel->response_tail, answered, channel->client_sleeping,
+                                           channel->shutdown);
+    }
+
+    // Pick up where the previous client left off; its requests were all answered
+    channel_ = channel;
+    next_ticket_ = channel->request_tail.load(std::memory_order_acquire);
+    channel->response_head.store(next_ticket_, std::memory_order_release);
+    return true;
+}
+
+void ShmClient::close() {
+    if (!channel_) return;
+    uint32_t pid = static_cast<uint32_t>(::getpid());
+    channel_->client_pid.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+    ::munmap(channel_, kShmMappingSize);
+    channel_ = nullptr;
+}
+
+ShmRequestSlot *ShmClient::begin_request() {
+    // A slot is free once the response that used it has been released
+    uint32_t released = channel_->response_head.load(std::memory_order_acquire);
+    if (next_ticket_ - released >= kShmSlots) return nullptr;
+    return &shm_request_slots(channel_)[next_ticket_ % kShmSlots];
+}
+
+uint32_t ShmClient::submit() {
+    uint32_t ticket = next_ticket_++;
+    shm_publish(channel_->request_tail, next_ticket_, channel_->server_sleeping);
+    return ticket;
+}
+
+const ShmResponseSlot *ShmClient::wait(uint32_t ticket) {
+    // response_tail counts answered requests; ours is done once it passes `ticket`
+    uint32_t done = channel_->response_tail.load(std::memory_order_acquire);
+    while (static_cast<int32_t>(done - ticket) <= 0) {
+        done = shm_wait_for_change(channel_->response_tail, done, channel_->client_sleeping, channel_->shutdown);
+        if (channel_->shutdown.load(std::memory_order_relaxed) && static_cast<int32_t>(done - ticket) <= 0)
+            return nullptr; // The server went away before answering
+    }
+    return &shm_response_slots(channel_)[ticket % kShmSlots];
+}
+
+void ShmClient::release(uint32_t ticket) {
+    // Responses are released in order, so "released up to ticket + 1" is enough
+    channel_->response_head.store(ticket + 1, std::memory_order_release);
+}
+
+bool ShmClient::validate(const std::vector<std::string_view> &cards, std::vector<ShmResult> &results) {
+    if (!channel_ || cards.size() > kShmMaxBatch) return false;
+    ShmRequestSlot *slot = begin_request();
+    if (!slot) return false;
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < cards.size(); ++i) {
+        if (offset + cards[i].size() > kShmMaxBytes) return false;
+        slot->offsets[i] = offset;
+        std::memcpy(slot->bytes + offset, cards[i].data(), cards[i].size());
+        offset += static_cast<uint32_t>(cards[i].size());
+    }
+    slot->offsets[cards.size()] = offset;
+    slot->count = static_cast<uint32_t>(cards.size());
+
+    uint32_t ticket = submit();
+    const ShmResponseSlot *answer = wait(ticket);
+    if (!answer) return false;
+    results.assign(answer->results, answer->results + answer->count);
+    release(ticket);
+    return true;
+}
@@ -0,0 +1,106 @@
+#include "shm_channel.h"
+#include "huge_pages.h"
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ---------------------
+   Shared-memory Server
+---------------------- */
+
+namespace {
+
+std::atomic<uint32_t> *g_shutdown = nullptr;
+
+void handle_stop_signal(int) {
+    if (g_shutdown) g_shutdown->store(1, std::memory_order_relaxed);
+}
+
+// shm_open() names must start with exactly one '/'
+std::string shm_path(const std::string &name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+} // namespace
+
+int run_shm_server(const std::string &name) {
+    const std::string path = shm_path(name);
+    ::shm_unlink(path.c_str()); // Clear out a channel left behind by a crashed server
+
+    int fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(kShmMappingSize)) != 0) {
+        std::cerr << "[ERROR] Could not create shared memory channel " << path << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+    void *base = ::mmap(nullptr, kShmMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "[ERROR] Could not map shared memory channel " << path << "\n";
+        ::shm_unlink(path.c_str());
+        return 1;
+    }
+
+    // Every request and response goes through these pages: fault them in (and
+    // lock them with --lock-memory) before the first client shows up
+    advise_huge_mapping(base, kShmMappingSize);
+    if (!prefault_pages(base, kShmMappingSize, true, memory_options().lock))
+        std::cout << "[INFO] Could not lock the channel in memory (" << std::strerror(errno)
+                  << "); raise ulimit -l or grant CAP_IPC_LOCK\n";
+
+    // Build the header in place; the magic number goes in LAST, so a client
+    // that sees it knows everything else is ready
+    ShmChannel *channel = new (base) ShmChannel{};
+    channel->version = kShmVersion;
+    channel->slots = kShmSlots;
+    channel->max_batch = kShmMaxBatch;
+    channel->magic.store(kShmMagic, std::memory_order_release);
+
+    g_shutdown = &channel->shutdown;
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+
+    ShmRequestSlot *requests = shm_request_slots(channel);
+    ShmResponseSlot *responses = shm_response_slots(channel);
+    std::cout << "[INFO] Shared memory channel " << path << " ready (" << kShmSlots << " slots x "
+              << kShmMaxBatch << " cards)" << std::endl;
+
+    uint64_t batches = 0, cards = 0;
+    uint32_t head = channel->request_head.load(std::memory_order_relaxed);
+    while (!channel->shutdown.load(std::memory_order_relaxed)) {
+        uint32_t tail = channel->request_tail.load(std::memory_order_acquire);
+        if (tail == head) {
+            tail = shm_wait_for_change(channel->request_tail, head, channel->server_sleeping, channel->shutdown);
+            if (tail == head) continue; // Woken for shutdown (or a timeout)
+        }
+
+        // Answer every request that has piled up, straight from the shared bytes
+        while (head != tail) {
+            const ShmRequestSlot &req = requests[head % kShmSlots];
+            ShmResponseSlot &resp = responses[head % kShmSlots];
+            const uint32_t count = req.count < kShmMaxBatch ? req.count : kShmMaxBatch;
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t begin = req.offsets[i], end = req.offsets[i + 1];
+                if (end > kShmMaxBytes || begin > end) begin = end = 0; // Never trust a neighbour's offsets
+                resp.results[i] = to_shm_result(validate_card_quiet(std::string_view(req.bytes + begin, end - begin)));
+            }
+            resp.count = count;
+            ++head;
+            channel->request_head.store(head, std::memory_order_release);
+            shm_publish(channel->response_tail, head, channel->client_sleeping);
+            ++batches;
+            cards += count;
+        }
+    }
+
+    std::cout << "[INFO] Shared memory channel " << path << " closing after " << batches << " batches ("
+              << cards << " cards)\n";
+    g_shutdown = nullptr;
+    ::munmap(base, kShmMappingSize);
+    ::shm_unlink(path.c_str());
+    return 0;
+}
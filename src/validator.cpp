@@ -1,73 +1,148 @@
 #include "validator.h"
+#include "digit_scan.h"
+#include "metrics.h"
+#include "mod10.h"
+#include "policy.h"
+#include <array>
+#include <cctype>
 #include <iostream>
 #include <chrono>
 #include <cmath>
-#include <unordered_map>
 
 /* ---------------------
    Helper Functions
 ---------------------- */
 
-// Normalize input by removing spaces
-std::string normalize_input(const std::string &input) {
+// Normalize input by removing spaces.
+// Returns a view, not a copy: either the original digits, or a static error
+// message (which is never 13-19 characters of digits, so it fails the length check).
+std::string_view normalize_input(std::string_view input) {
     for (char c : input)
-        if (!isdigit(c))
+        if (!isdigit(static_cast<unsigned char>(c)))
             return "Invalid credit card number";
     return input; // all digits, return original
 }
 
 
+namespace {
+
+// Which scheme owns which 4-digit prefixes (IIN ranges; none of them overlap)
+constexpr IssuerPrefixRange kPrefixRanges[] = {
+    {4000, 4999, Issuer::Visa},
+    {5100, 5599, Issuer::Mastercard}, {2221, 2720, Issuer::Mastercard},
+    {3400, 3499, Issuer::Amex},       {3700, 3799, Issuer::Amex},
+    {6011, 6011, Issuer::Discover},   {6440, 6599, Issuer::Discover},
+    {3000, 3059, Issuer::Diners},     {3095, 3095, Issuer::Diners},
+    {3600, 3699, Issuer::Diners},     {3800, 3999, Issuer::Diners},
+    {3528, 3589, Issuer::Jcb},
+    {6200, 6299, Issuer::UnionPay},
+    {2014, 2014, Issuer::Enroute},    {2149, 2149, Issuer::Enroute},
+};
+
+constexpr uint32_t lengths(size_t lo, size_t hi) {
+    uint32_t mask = 0;
+    for (size_t l = lo; l <= hi; ++l) mask |= 1u << l;
+    return mask;
+}
+constexpr uint32_t kLuhn = 1;
+
+// One packed rule per scheme, indexed by Issuer
+constexpr std::array<IssuerRule, static_cast<size_t>(Issuer::Count)> kIssuerRules = {{
+    {lengths(13, 19) | kLuhn},                                     // Unknown: the classic 13-19 check
+    {lengths(13, 13) | lengths(16, 16) | lengths(19, 19) | kLuhn}, // Visa
+    {lengths(16, 16) | kLuhn},                                     // Mastercard
+    {lengths(15, 15) | kLuhn},                                     // Amex
+    {lengths(16, 19) | kLuhn},                                     // Discover
+    {lengths(14, 19) | kLuhn},                                     // Diners
+    {lengths(16, 19) | kLuhn},                                     // JCB
+    {lengths(16, 19)},                                             // UnionPay: not every card has a Luhn digit
+    {lengths(15, 15)},                                             // enRoute (old Diners): never had one
+}};
+
+// A static table indexed by the first four digits: one array read, no comparisons.
+// 10,000 one-byte entries, but a real batch only ever touches a handful of its cache lines.
+constexpr std::array<Issuer, 10000> kPrefixIssuers = [] {
+    std::array<Issuer, 10000> table;
+    table.fill(Issuer::Unknown);
+    for (const IssuerPrefixRange &range : kPrefixRanges)
+        for (size_t p = range.first; p <= range.last; ++p) table[p] = range.issuer;
+    return table;
+}();
+
+} // namespace
+
+Issuer issuer_from_prefix(unsigned prefix) {
+    return prefix < kPrefixIssuers.size() ? kPrefixIssuers[prefix] : Issuer::Unknown;
+}
+
+Issuer detect_issuer_id(std::string_view number) {
+    // Shorter numbers are padded with zeros ("4" reads as 4000, still VISA);
+    // anything that isn't a digit means we can't tell.
+    unsigned prefix = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        unsigned digit = i < number.size() ? unsigned(number[i] - '0') : 0;
+        if (digit > 9) return Issuer::Unknown;
+        prefix = prefix * 10 + digit;
+    }
+    return kPrefixIssuers[prefix];
+}
+
+std::span<const IssuerPrefixRange> issuer_prefix_ranges() {
+    return kPrefixRanges;
+}
+
+IssuerRule issuer_rule(Issuer issuer) {
+    return kIssuerRules[static_cast<size_t>(issuer) < kIssuerRules.size() ? static_cast<size_t>(issuer) : 0];
+}
+
 std::string_view detect_issuer(std::string_view number) {
-    // A static table of C-style strings (effectively pointers)
-    static constexpr std::array<std::string_view, 256> lookup = [] {
-        std::array<std::string_view, 256> table;
-        table.fill("UNKNOWN");
-        table['4'] = "VISA";
-        table['5'] = "MASTERCARD";
-        return table;
-    }();
-
-    // Use the character itself as the index. 
-    // We use a guard to handle the empty string case branchlessly.
-    size_t index = number.empty() ? 0 : static_cast<unsigned char>(number[0]);
-    
-    return lookup[index];
+    return issuer_name(detect_issuer_id(number));
+}
 
+Issuer issuer_from_name(std::string_view name) {
+    for (size_t i = 1; i < static_cast<size_t>(Issuer::Count); ++i)
+        if (name == issuer_name(static_cast<Issuer>(i))) return static_cast<Issuer>(i);
+    return Issuer::Unknown;
 }
 
-// Validate a credit card number using Luhn's algorithm
-bool luhn_check(const std::string &number) {
-    int sum = 0;               
-    bool double_digit = false; // Flag to double every second digit from the right
-   // Notice: 'it' is a pointer-like object (iterator), but dont be afraid, it's almost like you reveryday for loop
-    // Reverse-iterator loop (safe way to traverse from last to first character)
-    for (auto it = number.rbegin(); it != number.rend(); ++it) {
-        int digit = *it - '0'; // Convert character to integer
-        if (double_digit) {
-            digit *= 2;
-            if (digit > 9) digit -= 9; // Sum digits of doubled number
-        }
-        sum += digit;
-        double_digit = !double_digit;
+const char *issuer_name(Issuer issuer) {
+    switch (issuer) {
+        case Issuer::Visa: return "VISA";
+        case Issuer::Mastercard: return "MASTERCARD";
+        case Issuer::Amex: return "AMEX";
+        case Issuer::Discover: return "DISCOVER";
+        case Issuer::Diners: return "DINERS";
+        case Issuer::Jcb: return "JCB";
+        case Issuer::UnionPay: return "UNIONPAY";
+        case Issuer::Enroute: return "ENROUTE";
+        default: return "UNKNOWN";
     }
+}
 
-    return sum % 10 == 0; // Valid if divisible by 10
+// Validate a credit card number using Luhn's algorithm: double every second
+// digit from the right (9 comes off a two-digit result), add everything up,
+// and the total must end in 0. The adding up is the shared mod-10 kernel in
+// mod10.h, which does all the digits at once with SSE2.
+bool luhn_check(std::string_view number) {
+    return mod10_sum<2, true>(number.data(), number.size()) % 10 == 0; // Valid if divisible by 10
 }
-// Notice: 'it' is a pointer-like object (iterator), but you don't need to fear it!
 
 
 // Entropy: calculates the Shannon Entropy to measure the randomness of the digits
-double calculate_entropy(const std::string &number) {
-    std::unordered_map<char,int> freq; // A map to store how many times each digit (0-9) appears
+double calculate_entropy(std::string_view number) {
+    // A tally sheet with one box per possible character: how many times each digit (0-9) appears.
+    // It lives on the stack, so unlike a hash map it never asks the heap for memory.
+    std::array<int, 256> freq{};
     
     // Count the frequency of every character in the string
-    for (char c : number) freq[c]++; 
+    for (char c : number) freq[static_cast<unsigned char>(c)]++; 
     
     double entropy = 0.0;     // Initialize entropy sum
     int len = number.size();   // Total length of the string for probability math
     
-    // Loop through each entry in the frequency map (k = character, v = count)
-    for (auto &[k,v] : freq) {
+    // Loop through each box of the tally sheet (v = count), skipping the empty ones
+    for (int v : freq) {
+        if (v == 0) continue;
         // Calculate probability 'p' (how often this digit appears relative to total length)
         double p = double(v) / len;
         
@@ -77,6 +152,39 @@ double calculate_entropy(const std::string &number) {
     }
     return entropy; // Returns the total bits of randomness per digit
 }
+
+namespace {
+
+// -p log2 p for every (count, length) a digit scan can produce, worked out once
+// at startup: exactly the terms calculate_entropy() adds, so the sums match to the bit
+using EntropyTerms = std::array<std::array<double, kMaxScanDigits + 1>, kMaxScanDigits + 1>;
+const EntropyTerms kEntropyTerms = [] {
+    EntropyTerms terms{};
+    for (int len = 1; len <= int(kMaxScanDigits); ++len)
+        for (int v = 1; v <= len; ++v) {
+            double p = double(v) / len;
+            terms[len][v] = -p * log2(p);
+        }
+    return terms;
+}();
+
+DigitKernel g_digit_kernel = DigitKernel::Fused;
+
+} // namespace
+
+// The same sum as calculate_entropy(), from the tally the scan already made: ten
+// table reads, no log2. A digit that never occurs adds terms[0] = 0.0, which
+// leaves the sum exactly as it was.
+double scan_entropy(const DigitScan &scan) {
+    const auto &terms = kEntropyTerms[scan.length];
+    double entropy = 0.0;
+    for (uint8_t count : scan.counts) entropy += terms[count];
+    return entropy;
+}
+
+void set_digit_kernel(DigitKernel kernel) { g_digit_kernel = kernel; }
+DigitKernel active_digit_kernel() { return g_digit_kernel; }
+
 // Optimized Repetition Check: Zero heap allocations
 bool repetition_check_optimized(std::string_view number) {
     // len is the size of the pattern we are looking for (e.g., "12" has len 2)
@@ -101,59 +209,116 @@ bool repetition_check_optimized(std::string_view number) {
 /* ---------------------
     Main Validator
 ---------------------- */
-CardResult validate_card(const std::string &input) {
-    // Record the start time using a high-precision nanosecond clock
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    // Clean the input (remove spaces/dashes) before processing
-    std::string normalized = normalize_input(input);
 
+// The shared engine behind validate_card() and validate_card_quiet().
+// `log` is where the [INFO]/[RESULT] narration goes; nullptr means "stay silent".
+// Each stage is wrapped in a StageTimer, the stopwatch from metrics.h, so the
+// per-stage histograms can tell us WHICH step is slow (not just the total).
+// With the fused kernel (digit_scan.h, the default) one pass over the digits
+// answers normalize, issuer, Luhn, entropy and repetition up front, timed as
+// the "scan" stage; the steps below then only read its answers.
+CARDGUARD_HOT_CLONES static CardResult run_validation(std::string_view input, std::ostream *log) {
     CardResult res; // Object to store all our findings (issuer, luhn status, etc.)
-    std::cout << "[INFO] Input normalized (spaces removed)\n";
+    const bool timed = metrics_sample_card(); // Is this card one of the sampled ones?
+    const bool fused = g_digit_kernel == DigitKernel::Fused && input.size() <= kMaxScanDigits;
+    const bool staged_timed = timed && !fused;
 
-    // Standard card length check: generally between 13 and 19 digits
-    if (normalized.size() < 13 || normalized.size() > 19) {
-        std::cout << "[INFO] Length check failed (" << normalized.size() << " digits)\n";
-        res.valid = false;
-        return res; // Stop immediately if length is wrong
+    // Clean the input (remove spaces/dashes) before processing
+    std::string_view normalized;
+    DigitScan scan;
+    if (fused) {
+        StageTimer timer(Stage::Scan, timed);
+        scan = scan_digits(input);
+        normalized = scan.digits ? input : normalize_input(input);
     } else {
-        std::cout << "[INFO] Length check passed (" << normalized.size() << " digits)\n";
+        StageTimer timer(Stage::Normalize, timed);
+        normalized = normalize_input(input);
     }
+    if (log) *log << "[INFO] Input normalized (spaces removed)\n";
 
-    // Step 1: Identify the card brand (Visa, Mastercard, etc.)
-    res.issuer = detect_issuer(normalized);
-    std::cout << "[INFO] Issuer pattern recognized: " << res.issuer << "\n";
+    // Step 1: Identify the card brand (Visa, Amex, etc.) from its first digits,
+    // and with it the scheme's rule: which lengths it allows and whether it has a
+    // Luhn check digit. A non-digit input counts as 0 digits.
+    const Policy &policy = active_policy();
+    const size_t digits = normalized.empty() || !isdigit(static_cast<unsigned char>(normalized[0]))
+                              ? 0 : normalized.size();
+    IssuerRule rule;
+    {
+        StageTimer timer(Stage::Issuer, staged_timed);
+        res.issuer_id = !fused ? detect_issuer_id(normalized)
+                        : scan.digits ? issuer_from_prefix(scan.prefix) : Issuer::Unknown;
+        res.issuer = issuer_name(res.issuer_id);
+        rule = issuer_rule(res.issuer_id);
+    }
+
+    // Length check: one bit test against the scheme's allowed lengths (and the
+    // lengths the active policy can accept at all), before any other digit work
+    {
+        StageTimer timer(Stage::Length, timed);
+        res.length_pass = rule.allows(digits);
+    }
+    if (!res.length_pass || !policy.length_live(digits)) {
+        if (log) *log << "[INFO] Length check failed (" << normalized.size() << " digits, issuer " << res.issuer << ")\n";
+        record_card_outcome(false, false);
+        return res; // Stop immediately if length is wrong
+    }
+    if (log) *log << "[INFO] Length check passed (" << normalized.size() << " digits)\n";
+    if (log) *log << "[INFO] Issuer pattern recognized: " << res.issuer << "\n";
 
     // Step 2: Run the mathematical Luhn algorithm
-    res.luhn_pass = luhn_check(normalized);
-    std::cout << "[INFO] Luhn checksum: " << (res.luhn_pass ? "PASS" : "FAIL") << "\n";
+    // (skipped for schemes whose numbers carry no check digit: they pass by definition)
+    {
+        StageTimer timer(Stage::Luhn, staged_timed);
+        res.luhn_pass = !rule.luhn_required() || (fused ? scan.luhn_sum % 10 == 0 : luhn_check(normalized));
+    }
+    if (log) *log << "[INFO] Luhn checksum: "
+                  << (!rule.luhn_required() ? "NOT USED BY ISSUER" : res.luhn_pass ? "PASS" : "FAIL") << "\n";
 
-    // Step 3: Check for randomness (threshold 3.5 is common for secure IDs)
-    res.entropy = calculate_entropy(normalized);
-    bool entropy_pass = res.entropy >= 3.5;
-    std::cout << "[INFO] Entropy score: " << res.entropy << " bits/digit (threshold: 3.5) "
-              << (entropy_pass ? "PASS" : "FAIL") << "\n";
+    // Step 3: Check for randomness (threshold 3.5 is common for secure IDs, the policy may say otherwise)
+    {
+        StageTimer timer(Stage::Entropy, staged_timed);
+        res.entropy = fused ? scan_entropy(scan) : calculate_entropy(normalized);
+        res.entropy_pass = res.entropy >= policy.entropy_threshold();
+    }
+    if (log) *log << "[INFO] Entropy score: " << res.entropy << " bits/digit (threshold: " << policy.entropy_threshold() << ") "
+                  << (res.entropy_pass ? "PASS" : "FAIL") << "\n";
 
     // Step 4: Ensure the number isn't just a simple repeating pattern
-    res.repetition_pass = repetition_check(normalized);
-    std::cout << "[INFO] Repetition analysis: " << (res.repetition_pass ? "PASS" : "FAIL") << "\n";
+    {
+        StageTimer timer(Stage::Repetition, staged_timed);
+        res.repetition_pass = fused ? scan.repeat == 0 : repetition_check_optimized(normalized);
+    }
+    if (log) *log << "[INFO] Repetition analysis: " << (res.repetition_pass ? "PASS" : "FAIL") << "\n";
 
-    // Combine all results:
+    // Combine all results with the active policy (policy.h). By default:
     // If it passes everything, it's fully valid.
-    if (res.luhn_pass && entropy_pass && res.repetition_pass) {
-        res.valid = true;
-        std::cout << "[RESULT] Card number is VALID\n";
-    } 
-    // If it only passes Luhn, it might be real but is "low confidence" (suspicious)
-    else if (res.luhn_pass) {
-        res.valid = true;
-        std::cout << "[RESULT] Card number is VALID (low confidence)\n";
-    } 
-    // Otherwise, it's definitely invalid
-    else {
-        res.valid = false;
-        std::cout << "[RESULT] Card number is INVALID\n";
+    // If it only passes Luhn, it might be real but is "low confidence" (suspicious).
+    // Otherwise, it's definitely invalid.
+    Verdict verdict;
+    {
+        StageTimer timer(Stage::Policy, timed);
+        verdict = policy.decide(digits, res.issuer_id,
+                                policy.facts(res.luhn_pass, res.repetition_pass, res.entropy, normalized));
     }
+    res.valid = verdict != Verdict::Invalid;
+    res.low_confidence = verdict == Verdict::LowConfidence;
+    record_card_outcome(res.valid, res.low_confidence);
+
+    if (log) {
+        if (!res.valid) *log << "[RESULT] Card number is INVALID\n";
+        else if (res.low_confidence) *log << "[RESULT] Card number is VALID (low confidence)\n";
+        else *log << "[RESULT] Card number is VALID\n";
+    }
+    return res;
+}
+
+CardResult validate_card(const std::string &input) {
+    // Record the start time using a high-precision nanosecond clock
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    const IdType type = active_id_type();
+    CardResult res = type == IdType::Card ? run_validation(input, &std::cout)
+                                          : validate_identifier(input, type, &std::cout);
 
     // Stop the clock and calculate how many nanoseconds the process took
     auto end_time = std::chrono::high_resolution_clock::now();
@@ -162,3 +327,9 @@ CardResult validate_card(const std::string &input) {
 
     return res;
 }
+
+// Batch-friendly twin of validate_card(): identical checks, no console output
+CardResult validate_card_quiet(std::string_view input) {
+    const IdType type = active_id_type();
+    return type == IdType::Card ? run_validation(input, nullptr) : validate_identifier(input, type, nullptr);
+}